@@ -0,0 +1,134 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "external_sorter.hpp"
+
+// Makes sure that everything written to a file so far survives a crash of the whole machine, not only of the program
+inline void sync_file(const std::string& path) {
+#ifdef _WIN32
+    int file = _open(path.c_str(), _O_WRONLY | _O_BINARY);
+    bool synced = file != -1 && _commit(file) == 0;
+    if (file != -1) {
+        _close(file);
+    }
+#else
+    int file = open(path.c_str(), O_RDONLY);
+    bool synced = file != -1 && fsync(file) == 0;
+    if (file != -1) {
+        close(file);
+    }
+#endif
+
+    if (!synced) {
+        throw std::runtime_error("Could not sync '" + path + "'");
+    }
+}
+
+// Progress of a compression run. Everything up to input_offset in the uncompressed input has been parsed; the column
+// files are valid up to column_positions and the contributors seen so far are in the dictionary runs.
+struct Checkpoint {
+    unsigned long long page_count;
+    unsigned long long input_offset;
+    std::vector<unsigned long long> column_positions;
+    std::vector<ExternalSorterState> dictionaries;
+
+    // The checkpoint is written to a temporary file that then replaces the old one, so there is always a complete one
+    void save(const std::string& path) const {
+        std::string temporary_path = path + ".tmp";
+
+        {
+            std::ofstream output(temporary_path, std::ios::binary);
+            output.write(MAGIC, sizeof(MAGIC));
+            write_integer(output, page_count);
+            write_integer(output, input_offset);
+
+            write_integer(output, column_positions.size());
+            for (unsigned long long position : column_positions) {
+                write_integer(output, position);
+            }
+
+            write_integer(output, dictionaries.size());
+            for (const ExternalSorterState& dictionary : dictionaries) {
+                write_integer(output, dictionary.next_run_index);
+                write_integer(output, dictionary.run_paths.size());
+                for (const std::string& run_path : dictionary.run_paths) {
+                    output.write(run_path.c_str(), run_path.length() + 1);
+                }
+            }
+
+            if (!output.flush()) {
+                throw std::runtime_error("Could not write '" + temporary_path + "'");
+            }
+        }
+
+        sync_file(temporary_path);
+        std::filesystem::rename(temporary_path, path);
+    }
+
+    // Returns false if there is no checkpoint
+    bool load(const std::string& path) {
+        std::ifstream input(path, std::ios::binary);
+        if (!input.is_open()) {
+            return false;
+        }
+
+        char magic[sizeof(MAGIC)];
+        if (!input.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), MAGIC)) {
+            throw std::runtime_error("'" + path + "' is not a checkpoint");
+        }
+
+        page_count = read_integer(input);
+        input_offset = read_integer(input);
+
+        column_positions.resize(read_integer(input));
+        for (unsigned long long& position : column_positions) {
+            position = read_integer(input);
+        }
+
+        dictionaries.resize(read_integer(input));
+        for (ExternalSorterState& dictionary : dictionaries) {
+            dictionary.next_run_index = read_integer(input);
+            dictionary.run_paths.resize(read_integer(input));
+            for (std::string& run_path : dictionary.run_paths) {
+                std::getline(input, run_path, '\0');
+            }
+        }
+
+        if (!input) {
+            throw std::runtime_error("Checkpoint '" + path + "' is truncated");
+        }
+        return true;
+    }
+
+    static void remove(const std::string& path) {
+        std::remove(path.c_str());
+    }
+
+private:
+    static constexpr char MAGIC[8] = { 'E', 'W', 'X', 'C', 'K', 'P', 'T', '2' };
+
+    static void write_integer(std::ostream& output, unsigned long long value) {
+        output.write((char*)&value, sizeof(value));
+    }
+
+    static unsigned long long read_integer(std::istream& input) {
+        unsigned long long value = 0;
+        input.read((char*)&value, sizeof(value));
+        return value;
+    }
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Reads the values of a column file through a large buffer, which is a lot faster than extracting them from an
+// std::ifstream one at a time
+class ColumnReader {
+public:
+    ColumnReader(const char* path, size_t buffer_size = 1 << 20) : input(path, std::ios::binary), buffer(buffer_size) {
+        position = 0;
+        end = 0;
+    }
+
+    bool is_open() const {
+        return input.is_open();
+    }
+
+    template <typename T>
+    bool read(T& value) {
+        if (end - position < sizeof(T) && !fill(sizeof(T))) {
+            return false;
+        }
+
+        memcpy(&value, buffer.data() + position, sizeof(T));
+        position += sizeof(T);
+        return true;
+    }
+
+    // Reads a NUL-terminated string
+    bool read(std::string& value) {
+        value.clear();
+
+        while (true) {
+            const char* start = buffer.data() + position;
+            const char* terminator = (const char*) memchr(start, '\0', end - position);
+
+            if (terminator != nullptr) {
+                value.append(start, terminator);
+                position += terminator - start + 1;
+                return true;
+            }
+
+            value.append(start, end - position);
+            position = end;
+
+            if (!fill(1)) {
+                return false;
+            }
+        }
+    }
+
+private:
+    std::ifstream input;
+    std::vector<char> buffer;
+    size_t position;
+    size_t end;
+
+    // Keeps the unread bytes and reads more after them; returns false if fewer than count bytes are left
+    bool fill(size_t count) {
+        memmove(buffer.data(), buffer.data() + position, end - position);
+        end -= position;
+        position = 0;
+
+        input.read(buffer.data() + end, buffer.size() - end);
+        end += (size_t) input.gcount();
+
+        return end >= count;
+    }
+};
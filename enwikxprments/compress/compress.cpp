@@ -1,29 +1,74 @@
+#include <cctype>
+#include <cstdlib>
 #include <iostream>
 
 #include "page_revision.hpp"
 
+// Parses sizes like "512M" or "4G"
+size_t parse_size(const char* text) {
+    char* suffix;
+    size_t size = strtoull(text, &suffix, 10);
+
+    switch (toupper(*suffix)) {
+    case 'G': size <<= 10; // fall through
+    case 'M': size <<= 10; // fall through
+    case 'K': size <<= 10;
+    }
+
+    return size;
+}
+
 int main(int argc, char** argv)
 try {
+    CompressOptions options;
+
     for (int arg_index = 1; arg_index < argc; ++arg_index) {
         std::string arg = argv[arg_index];
 
-        if (arg == "--compress") {
+        if (arg == "--max-memory") {
+            ++arg_index;
+            options.max_memory = parse_size(argv[arg_index]);
+        }
+        else if (arg == "--checkpoint-pages") {
+            ++arg_index;
+            options.checkpoint_pages = strtoull(argv[arg_index], nullptr, 10);
+        }
+        else if (arg == "--checkpoint-minutes") {
+            ++arg_index;
+            options.checkpoint_minutes = strtoul(argv[arg_index], nullptr, 10);
+        }
+        else if (arg == "--resume") {
+            options.resume = true;
+        }
+        else if (arg == "--compress") {
             ++arg_index;
             char* path = argv[arg_index];
 
-            PageRevisions page_revisions;
+            PageRevisions page_revisions(options);
 
             page_revisions.read_xml(path);
             page_revisions.write_binary();
         }
         else if (arg == "--decompress") {
             ++arg_index;
+
+            // With "--verify <original>" the output is compared with the original instead of being written
+            bool verify = arg_index + 1 < argc && std::string(argv[arg_index]) == "--verify";
+            if (verify) {
+                ++arg_index;
+            }
             char* path = argv[arg_index];
 
             PageRevisions page_revisions;
 
             page_revisions.read_binary();
-            page_revisions.write_xml(path);
+            if (verify) {
+                size_t size = page_revisions.verify_xml(path);
+                std::cout << "Verified " << size << " bytes" << std::endl;
+            }
+            else {
+                page_revisions.write_xml(path);
+            }
         }
         else {
             // TODO: print help;
@@ -31,6 +76,10 @@ try {
         }
     }
 }
+catch (VerificationError& error) {
+    std::cout << error.what() << std::endl;
+    return 2;
+}
 catch (xml::parsing& error) {
     std::cout
         << "Parsing error at position (" << error.line() << "," << error.column()
@@ -1,5 +1,13 @@
 #pragma once
 
+// The same codes as in the extractor; a contributor index is (index << 2) | type
+enum ContributorType : unsigned char {
+	IP_ADDRESS = 0,
+	IP_RANGE = 1,
+	IP_STRING = 2,
+	USERNAME = 3,
+};
+
 class Contributor {
 public:
 	virtual ~Contributor() {}
@@ -1,10 +1,13 @@
 #pragma once
 
 #include <algorithm>
+#include <memory>
+#include <stdexcept>
 #include <vector>
 
 #include "contributor.hpp"
 #include "contributors_with_ip_address.hpp"
+#include "contributors_with_ip_range.hpp"
 #include "contributors_with_ip_string.hpp"
 #include "contributors_with_username.hpp"
 
@@ -13,6 +16,10 @@ struct Contributors {
         this->with_ip_address.swap(with_ip_address);
     }
 
+    void swap(std::vector<ContributorWithIpRange>& with_ip_range) {
+        this->with_ip_range.swap(with_ip_range);
+    }
+
     void swap(std::vector<ContributorWithIpString>& with_ip_string) {
         this->with_ip_string.swap(with_ip_string);
     }
@@ -21,38 +28,42 @@ struct Contributors {
         this->with_username.swap(with_username);
     }
 
-    size_t get_index(const Contributor& contributor) const {
-        size_t result;
+    // Indices are local to each kind of contributor and tagged with its type, like (index << 2) | type
+    int get_index(const Contributor& contributor) const {
         if (auto c = dynamic_cast<const ContributorWithUsername*>(&contributor)) {
-            return get_index(with_username, *c);
+            return make_index(get_index(with_username, *c), USERNAME);
         }
         else if (auto c = dynamic_cast<const ContributorWithIpAddress*>(&contributor)) {
-            return with_username.size() + get_index(with_ip_address, *c);
+            return make_index(get_index(with_ip_address, *c), IP_ADDRESS);
+        }
+        else if (auto c = dynamic_cast<const ContributorWithIpRange*>(&contributor)) {
+            return make_index(get_index(with_ip_range, *c), IP_RANGE);
         }
         else if (auto c = dynamic_cast<const ContributorWithIpString*>(&contributor)) {
-            return with_username.size() + with_ip_address.size() + get_index(with_ip_string, *c);
+            return make_index(get_index(with_ip_string, *c), IP_STRING);
         }
         else {
-            throw new std::invalid_argument("Unsupported contributor type");
+            throw std::invalid_argument("Unsupported contributor type");
         }
     }
 
-    std::shared_ptr<Contributor> get(size_t index) {
-        if (index < with_username.size()) {
-            return std::shared_ptr<Contributor>(new ContributorWithUsername(with_username[index]));
-        }
-        index -= with_username.size();
+    std::shared_ptr<Contributor> get(int index) const {
+        size_t local_index = index >> 2;
 
-        if (index < with_ip_address.size()) {
-            return std::shared_ptr<Contributor>(new ContributorWithIpAddress(with_ip_address[index]));
-        }
-        index -= with_ip_address.size();
-
-        if (index < with_ip_string.size()) {
-            return std::shared_ptr<Contributor>(new ContributorWithIpString(with_ip_string[index]));
+        switch (index & 3) {
+        case IP_ADDRESS:
+            return std::shared_ptr<Contributor>(new ContributorWithIpAddress(with_ip_address.at(local_index)));
+        case IP_RANGE:
+            return std::shared_ptr<Contributor>(new ContributorWithIpRange(with_ip_range.at(local_index)));
+        case IP_STRING:
+            return std::shared_ptr<Contributor>(new ContributorWithIpString(with_ip_string.at(local_index)));
+        default:
+            return std::shared_ptr<Contributor>(new ContributorWithUsername(with_username.at(local_index)));
         }
+    }
 
-        throw new std::invalid_argument("Invalid contributor index");
+    static int make_index(size_t index, ContributorType type) {
+        return (int) (index << 2) | type;
     }
 
     template<typename T>
@@ -61,6 +72,7 @@ struct Contributors {
     }
 
     std::vector<ContributorWithIpAddress> with_ip_address;
+    std::vector<ContributorWithIpRange> with_ip_range;
     std::vector<ContributorWithIpString> with_ip_string;
     std::vector<ContributorWithUsername> with_username;
 };
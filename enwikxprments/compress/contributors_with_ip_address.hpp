@@ -1,5 +1,10 @@
 #pragma once
 
+#include <cstdio>
+#include <istream>
+#include <ostream>
+#include <string>
+
 #include "contributor.hpp"
 
 union IP {
@@ -13,6 +18,29 @@ struct ContributorWithIpAddress: public Contributor {
 	ContributorWithIpAddress(IP ip): ip(ip) {
 	}
 
+	// Returns false unless the text is exactly how the address would be written back, e.g. "1.2.3.4" but not "1.2.3.04"
+	static bool parse(const std::string& text, ContributorWithIpAddress& contributor) {
+		unsigned components[4];
+		if (sscanf_s(text.c_str(), "%u.%u.%u.%u", components, components + 1, components + 2, components + 3) != 4) {
+			return false;
+		}
+
+		for (int i = 0; i < 4; i++) {
+			if (components[i] > 255) {
+				return false;
+			}
+			contributor.ip.components[i] = (unsigned char) components[i];
+		}
+
+		return contributor.to_string() == text;
+	}
+
+	std::string to_string() const {
+		char text[16];
+		snprintf(text, sizeof(text), "%u.%u.%u.%u", ip.components[0], ip.components[1], ip.components[2], ip.components[3]);
+		return text;
+	}
+
 	bool operator==(const ContributorWithIpAddress& other) const {
 		return this->ip.address == other.ip.address;
 	}
@@ -21,5 +49,17 @@ struct ContributorWithIpAddress: public Contributor {
 		return this->ip.address < other.ip.address;
 	}
 
+	void write(std::ostream& output) const {
+		output.write((char*)&ip, sizeof(ip));
+	}
+
+	bool read(std::istream& input) {
+		return (bool) input.read((char*)&ip, sizeof(ip));
+	}
+
+	size_t memory_size() const {
+		return sizeof(*this);
+	}
+
 	IP ip;
 };
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <string>
+
+#include "contributor.hpp"
+
+// An IP address with a hidden last component, like "192.168.0.xxx"
+struct ContributorWithIpRange : public Contributor {
+	ContributorWithIpRange() {}
+
+	// Returns false unless the text is exactly how the range would be written back
+	static bool parse(const std::string& text, ContributorWithIpRange& contributor) {
+		unsigned components[3];
+		if (sscanf_s(text.c_str(), "%u.%u.%u.xxx", components, components + 1, components + 2) != 3) {
+			return false;
+		}
+
+		for (int i = 0; i < 3; i++) {
+			if (components[i] > 255) {
+				return false;
+			}
+			contributor.components[i] = (unsigned char) components[i];
+		}
+
+		return contributor.to_string() == text;
+	}
+
+	std::string to_string() const {
+		char text[16];
+		snprintf(text, sizeof(text), "%u.%u.%u.xxx", components[0], components[1], components[2]);
+		return text;
+	}
+
+	bool operator==(const ContributorWithIpRange& other) const {
+		return memcmp(this->components, other.components, sizeof(components)) == 0;
+	}
+
+	bool operator<(const ContributorWithIpRange& other) const {
+		return memcmp(this->components, other.components, sizeof(components)) < 0;
+	}
+
+	void write(std::ostream& output) const {
+		output.write((char*)components, sizeof(components));
+	}
+
+	bool read(std::istream& input) {
+		return (bool) input.read((char*)components, sizeof(components));
+	}
+
+	size_t memory_size() const {
+		return sizeof(*this);
+	}
+
+	unsigned char components[3];
+};
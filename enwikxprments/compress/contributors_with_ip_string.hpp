@@ -1,5 +1,7 @@
 #pragma once
 
+#include <istream>
+#include <ostream>
 #include <string>
 
 #include "contributor.hpp"
@@ -18,5 +20,17 @@ struct ContributorWithIpString : public Contributor {
 		return this->address < other.address;
 	}
 
+	void write(std::ostream& output) const {
+		output.write(address.c_str(), address.length() + 1);
+	}
+
+	bool read(std::istream& input) {
+		return (bool) std::getline(input, address, '\0');
+	}
+
+	size_t memory_size() const {
+		return sizeof(*this) + address.capacity();
+	}
+
 	std::string address;
 };
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <istream>
+#include <ostream>
 #include <string>
 
 #include "contributor.hpp"
@@ -18,6 +20,19 @@ struct ContributorWithUsername : public Contributor {
 		return this->id != other.id ? this->id < other.id : this->username < other.username;
 	}
 
+	void write(std::ostream& output) const {
+		output.write((char*)&id, sizeof(id));
+		output.write(username.c_str(), username.length() + 1);
+	}
+
+	bool read(std::istream& input) {
+		return input.read((char*)&id, sizeof(id)) && std::getline(input, username, '\0');
+	}
+
+	size_t memory_size() const {
+		return sizeof(*this) + username.capacity();
+	}
+
 	int id;
 	std::string username;
 };
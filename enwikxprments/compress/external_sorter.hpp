@@ -0,0 +1,252 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// What a checkpoint needs to restart an ExternalSorter: everything pushed before it is in the listed runs
+struct ExternalSorterState {
+    std::vector<std::string> run_paths;
+    size_t next_run_index;
+};
+
+// Sorts and deduplicates a stream of items. The items are buffered in memory and compacted from time to time; if a
+// memory budget is given and the compacted buffer still does not fit in it, it is spilled to disk as a sorted run.
+// All runs are combined with a k-way merge at the end, so the result is the same as sorting everything in memory.
+//
+// T needs operator<, operator==, write(std::ostream&), read(std::istream&) and memory_size().
+template <typename T>
+class ExternalSorter {
+public:
+    // A memory budget of 0 means that nothing is spilled to disk
+    ExternalSorter(const std::string& run_path_prefix, size_t memory_budget = 0) :
+        run_path_prefix(run_path_prefix), memory_budget(memory_budget) {
+        buffer_memory = 0;
+        compacted_size = 0;
+        next_run_index = 0;
+    }
+
+    // Runs referenced by a saved state are left on disk, so that an interrupted program can be resumed
+    ~ExternalSorter() {
+        remove_runs(false);
+    }
+
+    void push(const T& item) {
+        buffer.push_back(item);
+        buffer_memory += item.memory_size();
+
+        if (memory_budget > 0 ? buffer_memory > memory_budget : buffer.size() >= 2 * compacted_size + 1024) {
+            compact();
+
+            if (memory_budget > 0 && buffer_memory > memory_budget / 2) {
+                spill();
+            }
+        }
+    }
+
+    // Passes every unique item to the consumer in ascending order
+    template <typename Consumer>
+    void merge(Consumer consumer) {
+        compact();
+
+        if (run_paths.empty()) {
+            for (const T& item : buffer) {
+                consumer(item);
+            }
+        }
+        else {
+            spill();
+
+            while (run_paths.size() > MAX_MERGE_WIDTH) {
+                merge_run_group();
+            }
+            merge_runs(0, run_paths.size(), consumer);
+        }
+
+        std::vector<T>().swap(buffer);
+        buffer_memory = 0;
+        compacted_size = 0;
+        remove_runs(false);
+    }
+
+    size_t run_count() const {
+        return run_paths.size();
+    }
+
+    // Spills everything pushed so far to disk. The runs are kept until a later state is committed or clear(), even if
+    // they get merged in the meantime.
+    ExternalSorterState save_state() {
+        compact();
+        if (!buffer.empty()) {
+            spill();
+        }
+
+        for (const std::string& run_path : run_paths) {
+            if (!is_saved(run_path)) {
+                saved_run_paths.push_back(run_path);
+            }
+        }
+        return ExternalSorterState{ run_paths, next_run_index };
+    }
+
+    // Called once the checkpoint that holds the state has replaced the previous one. The runs that only the previous
+    // checkpoints needed, which merges have replaced since, are removed.
+    void commit_state(const ExternalSorterState& state) {
+        for (const std::string& run_path : saved_run_paths) {
+            if (std::find(state.run_paths.begin(), state.run_paths.end(), run_path) == state.run_paths.end()) {
+                std::remove(run_path.c_str());
+            }
+        }
+        saved_run_paths = state.run_paths;
+    }
+
+    // Continues from a saved state; only meant for a sorter that nothing has been pushed to yet
+    void restore_state(const ExternalSorterState& state) {
+        run_paths = state.run_paths;
+        saved_run_paths = state.run_paths;
+        next_run_index = state.next_run_index;
+    }
+
+    // Removes all runs, including the saved ones
+    void clear() {
+        std::vector<T>().swap(buffer);
+        buffer_memory = 0;
+        compacted_size = 0;
+        remove_runs(true);
+    }
+
+private:
+    static const size_t MAX_MERGE_WIDTH = 64;
+
+    struct RunHead {
+        T item;
+        size_t run_index;
+
+        bool operator<(const RunHead& other) const {
+            return other.item < item; // std::priority_queue is a max-heap
+        }
+    };
+
+    std::string run_path_prefix;
+    size_t memory_budget;
+
+    std::vector<T> buffer;
+    size_t buffer_memory;
+    size_t compacted_size;
+    std::vector<std::string> run_paths;
+    std::vector<std::string> saved_run_paths;
+    size_t next_run_index;
+
+    void compact() {
+        std::sort(buffer.begin(), buffer.end());
+        buffer.erase(std::unique(buffer.begin(), buffer.end()), buffer.end());
+        compacted_size = buffer.size();
+
+        buffer_memory = 0;
+        for (const T& item : buffer) {
+            buffer_memory += item.memory_size();
+        }
+    }
+
+    void spill() {
+        std::string run_path = next_run_path();
+        std::ofstream run(run_path, std::ios::binary);
+
+        for (const T& item : buffer) {
+            item.write(run);
+        }
+
+        if (!run) {
+            throw std::runtime_error("Could not write '" + run_path + "'");
+        }
+
+        run_paths.push_back(run_path);
+        std::vector<T>().swap(buffer);
+        buffer_memory = 0;
+        compacted_size = 0;
+    }
+
+    std::string next_run_path() {
+        return run_path_prefix + ".run" + std::to_string(next_run_index++);
+    }
+
+    // Replaces the oldest runs with a single merged one, so that the final merge does not open too many files
+    void merge_run_group() {
+        std::string run_path = next_run_path();
+
+        {
+            std::ofstream run(run_path, std::ios::binary);
+            merge_runs(0, MAX_MERGE_WIDTH, [&run](const T& item) { item.write(run); });
+
+            if (!run) {
+                throw std::runtime_error("Could not write '" + run_path + "'");
+            }
+        }
+
+        for (size_t i = 0; i < MAX_MERGE_WIDTH; i++) {
+            if (!is_saved(run_paths[i])) {
+                std::remove(run_paths[i].c_str());
+            }
+        }
+        run_paths.erase(run_paths.begin(), run_paths.begin() + MAX_MERGE_WIDTH);
+        run_paths.push_back(run_path);
+    }
+
+    template <typename Consumer>
+    void merge_runs(size_t first_run, size_t last_run, Consumer&& consumer) {
+        std::vector<std::ifstream> runs(last_run - first_run);
+        std::priority_queue<RunHead> heads;
+
+        for (size_t i = 0; i < runs.size(); i++) {
+            runs[i].open(run_paths[first_run + i], std::ios::binary);
+
+            RunHead head;
+            head.run_index = i;
+            if (head.item.read(runs[i])) {
+                heads.push(head);
+            }
+        }
+
+        bool has_last = false;
+        T last;
+
+        while (!heads.empty()) {
+            RunHead head = heads.top();
+            heads.pop();
+
+            if (!has_last || !(last == head.item)) {
+                consumer(head.item);
+                last = head.item;
+                has_last = true;
+            }
+
+            if (head.item.read(runs[head.run_index])) {
+                heads.push(head);
+            }
+        }
+    }
+
+    bool is_saved(const std::string& run_path) const {
+        return std::find(saved_run_paths.begin(), saved_run_paths.end(), run_path) != saved_run_paths.end();
+    }
+
+    void remove_runs(bool include_saved) {
+        for (const std::string& run_path : run_paths) {
+            if (include_saved || !is_saved(run_path)) {
+                std::remove(run_path.c_str());
+            }
+        }
+        run_paths.clear();
+
+        if (include_saved) {
+            for (const std::string& run_path : saved_run_paths) {
+                std::remove(run_path.c_str());
+            }
+            saved_run_paths.clear();
+        }
+    }
+};
@@ -0,0 +1,399 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <stdexcept>
+#include <vector>
+
+// Streaming decoder for raw DEFLATE data (RFC 1951). Output is passed to a sink in large chunks; only the last 32 KB
+// of output are kept around for back references.
+class Inflater {
+public:
+    Inflater(std::istream& input) : input(input), input_buffer(1 << 16), window(WINDOW_SIZE) {
+        input_position = 0;
+        input_end = 0;
+        input_overrun = 0;
+        bit_buffer = 0;
+        bit_count = 0;
+        window_position = 0;
+        window_flushed = 0;
+    }
+
+    unsigned char read_byte() {
+        drop_bits(bit_count % 8);
+        if (bit_count > 0) {
+            unsigned char result = (unsigned char) read_bits(8);
+            check_overrun();
+            return result;
+        }
+        if (input_position == input_end && !fill_input()) {
+            throw std::runtime_error("Unexpected end of archive");
+        }
+        return input_buffer[input_position++];
+    }
+
+    void skip(size_t count) {
+        while (count-- > 0) {
+            read_byte();
+        }
+    }
+
+    // Passes the rest of the input to the sink as it is
+    template <typename Sink>
+    void copy(Sink&& sink) {
+        drop_bits(bit_count % 8);
+        while ((size_t) bit_count > input_overrun * 8) {
+            char byte = (char) read_bits(8);
+            sink(&byte, 1);
+        }
+        do {
+            sink((const char*) input_buffer.data() + input_position, input_end - input_position);
+            input_position = input_end;
+        } while (fill_input());
+    }
+
+    template <typename Sink>
+    void inflate(Sink&& sink) {
+        bool last_block;
+
+        do {
+            last_block = read_bits(1);
+
+            switch (read_bits(2)) {
+            case 0:
+                inflate_stored(sink);
+                break;
+            case 1:
+                build_fixed_tables();
+                inflate_codes(sink);
+                break;
+            case 2:
+                build_dynamic_tables();
+                inflate_codes(sink);
+                break;
+            default:
+                throw std::runtime_error("Invalid deflate block type");
+            }
+        } while (!last_block);
+
+        flush(sink);
+    }
+
+private:
+    static const size_t WINDOW_SIZE = 1 << 22;
+    static const size_t HISTORY_SIZE = 1 << 15;
+    static const int MAX_CODE_LENGTH = 15;
+
+    struct HuffmanTable {
+        static const int ROOT_BITS = 10;
+
+        // Every entry is (symbol << 4) | code_length; codes longer than ROOT_BITS are left as 0 and decoded slowly
+        unsigned short root[1 << ROOT_BITS];
+        unsigned short counts[MAX_CODE_LENGTH + 1];
+        unsigned short symbols[288];
+
+        void build(const unsigned char* lengths, int symbol_count) {
+            std::fill(std::begin(counts), std::end(counts), 0);
+            std::fill(std::begin(root), std::end(root), 0);
+
+            for (int symbol = 0; symbol < symbol_count; symbol++) {
+                counts[lengths[symbol]]++;
+            }
+            counts[0] = 0;
+
+            int left = 1;
+            for (int length = 1; length <= MAX_CODE_LENGTH; length++) {
+                left = (left << 1) - counts[length];
+                if (left < 0) {
+                    throw std::runtime_error("Oversubscribed deflate code");
+                }
+            }
+
+            unsigned short offsets[MAX_CODE_LENGTH + 2];
+            offsets[1] = 0;
+            for (int length = 1; length <= MAX_CODE_LENGTH; length++) {
+                offsets[length + 1] = offsets[length] + counts[length];
+            }
+            for (int symbol = 0; symbol < symbol_count; symbol++) {
+                if (lengths[symbol]) {
+                    symbols[offsets[lengths[symbol]]++] = symbol;
+                }
+            }
+
+            unsigned code = 0;
+            int index = 0;
+            for (int length = 1; length <= ROOT_BITS; length++) {
+                for (int i = 0; i < counts[length]; i++, index++, code++) {
+                    unsigned reversed = reverse_bits(code, length);
+                    unsigned short entry = (symbols[index] << 4) | length;
+
+                    for (unsigned slot = reversed; slot < (1u << ROOT_BITS); slot += 1u << length) {
+                        root[slot] = entry;
+                    }
+                }
+                code <<= 1;
+            }
+        }
+
+        static unsigned reverse_bits(unsigned code, int length) {
+            unsigned result = 0;
+            for (int i = 0; i < length; i++) {
+                result = (result << 1) | (code & 1);
+                code >>= 1;
+            }
+            return result;
+        }
+    };
+
+    std::istream& input;
+    std::vector<unsigned char> input_buffer;
+    size_t input_position;
+    size_t input_end;
+    size_t input_overrun;
+
+    unsigned long long bit_buffer;
+    int bit_count;
+
+    std::vector<unsigned char> window;
+    size_t window_position;
+    size_t window_flushed;
+
+    HuffmanTable literal_table;
+    HuffmanTable distance_table;
+
+    bool fill_input() {
+        input.read((char*) input_buffer.data(), input_buffer.size());
+        input_position = 0;
+        input_end = (size_t) input.gcount();
+        return input_end > 0;
+    }
+
+    void refill_bits() {
+        while (bit_count <= 56) {
+            if (input_position == input_end && !fill_input()) {
+                // Pad with zeroes; reading into the padding is reported by check_overrun()
+                input_overrun++;
+                bit_count += 8;
+                continue;
+            }
+            bit_buffer |= (unsigned long long) input_buffer[input_position++] << bit_count;
+            bit_count += 8;
+        }
+    }
+
+    void check_overrun() const {
+        if (input_overrun * 8 > (size_t) bit_count) {
+            throw std::runtime_error("Unexpected end of deflate stream");
+        }
+    }
+
+    unsigned peek_bits(int count) {
+        if (bit_count < count) {
+            refill_bits();
+        }
+        return (unsigned) (bit_buffer & ((1ull << count) - 1));
+    }
+
+    void drop_bits(int count) {
+        bit_buffer >>= count;
+        bit_count -= count;
+    }
+
+    unsigned read_bits(int count) {
+        unsigned result = peek_bits(count);
+        drop_bits(count);
+        return result;
+    }
+
+    int decode(const HuffmanTable& table) {
+        unsigned entry = table.root[peek_bits(HuffmanTable::ROOT_BITS)];
+        if (entry) {
+            drop_bits(entry & 15);
+            return entry >> 4;
+        }
+
+        unsigned bits = peek_bits(MAX_CODE_LENGTH);
+        int code = 0;
+        int first = 0;
+        int index = 0;
+
+        for (int length = 1; length <= MAX_CODE_LENGTH; length++) {
+            code |= bits & 1;
+            bits >>= 1;
+
+            int count = table.counts[length];
+            if (code - count < first) {
+                drop_bits(length);
+                return table.symbols[index + (code - first)];
+            }
+            index += count;
+            first = (first + count) << 1;
+            code <<= 1;
+        }
+
+        throw std::runtime_error("Invalid deflate code");
+    }
+
+    template <typename Sink>
+    void flush(Sink& sink) {
+        check_overrun();
+        sink((const char*) window.data() + window_flushed, window_position - window_flushed);
+        window_flushed = window_position;
+    }
+
+    template <typename Sink>
+    void make_room(Sink& sink) {
+        if (window_position + 258 <= WINDOW_SIZE) {
+            return;
+        }
+
+        flush(sink);
+        std::copy(window.begin() + window_position - HISTORY_SIZE, window.begin() + window_position, window.begin());
+        window_position = HISTORY_SIZE;
+        window_flushed = window_position;
+    }
+
+    template <typename Sink>
+    void inflate_stored(Sink& sink) {
+        drop_bits(bit_count % 8);
+        unsigned length = read_bits(16);
+        unsigned complement = read_bits(16);
+
+        if ((length ^ 0xFFFF) != complement) {
+            throw std::runtime_error("Corrupted stored deflate block");
+        }
+
+        while (length-- > 0) {
+            make_room(sink);
+            window[window_position++] = read_byte();
+        }
+    }
+
+    void build_fixed_tables() {
+        unsigned char lengths[288];
+
+        std::fill(lengths, lengths + 144, 8);
+        std::fill(lengths + 144, lengths + 256, 9);
+        std::fill(lengths + 256, lengths + 280, 7);
+        std::fill(lengths + 280, lengths + 288, 8);
+        literal_table.build(lengths, 288);
+
+        std::fill(lengths, lengths + 30, 5);
+        distance_table.build(lengths, 30);
+    }
+
+    void build_dynamic_tables() {
+        static const unsigned char code_length_order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+        int literal_count = read_bits(5) + 257;
+        int distance_count = read_bits(5) + 1;
+        int code_length_count = read_bits(4) + 4;
+
+        if (literal_count > 286 || distance_count > 30) {
+            throw std::runtime_error("Invalid deflate code counts");
+        }
+
+        unsigned char lengths[286 + 30] = {};
+        for (int i = 0; i < code_length_count; i++) {
+            lengths[code_length_order[i]] = read_bits(3);
+        }
+
+        HuffmanTable code_length_table;
+        code_length_table.build(lengths, 19);
+
+        for (int index = 0; index < literal_count + distance_count; ) {
+            int symbol = decode(code_length_table);
+            int repeat;
+            unsigned char length = 0;
+
+            if (symbol < 16) {
+                lengths[index++] = symbol;
+                continue;
+            }
+            else if (symbol == 16) {
+                if (index == 0) {
+                    throw std::runtime_error("Invalid deflate code length repeat");
+                }
+                length = lengths[index - 1];
+                repeat = 3 + read_bits(2);
+            }
+            else if (symbol == 17) {
+                repeat = 3 + read_bits(3);
+            }
+            else {
+                repeat = 11 + read_bits(7);
+            }
+
+            if (index + repeat > literal_count + distance_count) {
+                throw std::runtime_error("Invalid deflate code length repeat");
+            }
+            std::fill(lengths + index, lengths + index + repeat, length);
+            index += repeat;
+        }
+
+        if (lengths[256] == 0) {
+            throw std::runtime_error("Missing deflate end of block code");
+        }
+
+        literal_table.build(lengths, literal_count);
+        distance_table.build(lengths + literal_count, distance_count);
+    }
+
+    template <typename Sink>
+    void inflate_codes(Sink& sink) {
+        static const unsigned short length_base[29] = {
+            3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+        static const unsigned char length_extra[29] = {
+            0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+        static const unsigned short distance_base[30] = {
+            1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+            4097, 6145, 8193, 12289, 16385, 24577 };
+        static const unsigned char distance_extra[30] = {
+            0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+        while (true) {
+            make_room(sink);
+            refill_bits();
+
+            int symbol = decode(literal_table);
+
+            if (symbol < 256) {
+                window[window_position++] = symbol;
+                continue;
+            }
+            if (symbol == 256) {
+                return;
+            }
+
+            symbol -= 257;
+            if (symbol >= 29) {
+                throw std::runtime_error("Invalid deflate length code");
+            }
+            size_t length = length_base[symbol] + read_bits(length_extra[symbol]);
+
+            symbol = decode(distance_table);
+            if (symbol >= 30) {
+                throw std::runtime_error("Invalid deflate distance code");
+            }
+            size_t distance = distance_base[symbol] + read_bits(distance_extra[symbol]);
+
+            if (distance > window_position) {
+                throw std::runtime_error("Deflate distance too far back");
+            }
+
+            unsigned char* destination = window.data() + window_position;
+            const unsigned char* source = destination - distance;
+            window_position += length;
+
+            if (distance >= length) {
+                memcpy(destination, source, length);
+            }
+            else {
+                while (length-- > 0) {
+                    *destination++ = *source++;
+                }
+            }
+        }
+    }
+};
@@ -0,0 +1,310 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#include "inflater.hpp"
+#include "ring_buffer.hpp"
+
+class RingBufferStreambuf : public std::streambuf {
+public:
+    // The ring buffer starts with a prefix of the given length, followed by the input from the given offset
+    RingBufferStreambuf(RingBuffer& ring_buffer, unsigned long long offset, size_t prefix_length) :
+        ring_buffer(ring_buffer), buffer(1 << 16), base_offset((long long) offset - prefix_length) {
+        consumed = 0;
+        page_end_matched = 0;
+        tail_start = offset;
+        setg(buffer.data(), buffer.data(), buffer.data());
+    }
+
+    // Returns the input position right after the oldest "</page>" that has been read but not popped yet
+    unsigned long long pop_page_end() {
+        if (page_ends.empty()) {
+            throw std::logic_error("No page end has been read");
+        }
+
+        unsigned long long result = page_ends.front();
+        page_ends.pop_front();
+        return result;
+    }
+
+    // Everything after the last "</page>" that has been read; the end of the dump once the input is exhausted
+    const std::string& tail() const {
+        return tail_text;
+    }
+
+protected:
+    int_type underflow() override {
+        if (gptr() < egptr()) {
+            return traits_type::to_int_type(*gptr());
+        }
+
+        size_t count = ring_buffer.read(buffer.data(), buffer.size());
+        scan(count);
+        consumed += count;
+        setg(buffer.data(), buffer.data(), buffer.data() + count);
+
+        return count > 0 ? traits_type::to_int_type(*gptr()) : traits_type::eof();
+    }
+
+    pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode mode) override {
+        if (offset != 0 || direction != std::ios_base::cur || mode != std::ios_base::in) {
+            return pos_type(off_type(-1));
+        }
+        return pos_type(base_offset + consumed - (egptr() - gptr()));
+    }
+
+private:
+    RingBuffer& ring_buffer;
+    std::vector<char> buffer;
+    long long base_offset;
+    off_type consumed;
+
+    std::deque<unsigned long long> page_ends;
+    size_t page_end_matched;
+    unsigned long long tail_start;
+    std::string tail_text;
+
+    // The parser reads ahead, so page boundaries are found in the raw bytes. A literal "</page>" can only be a tag,
+    // because '<' is always escaped in text.
+    void scan(size_t count) {
+        static const char PAGE_END[] = "</page>";
+        const char* data = buffer.data();
+
+        for (size_t i = 0; i < count; i++) {
+            if (page_end_matched == 0) {
+                const char* tag = (const char*) memchr(data + i, '<', count - i);
+                if (tag == nullptr) {
+                    break;
+                }
+                i = tag - data;
+            }
+
+            if (data[i] == PAGE_END[page_end_matched]) {
+                if (++page_end_matched == sizeof(PAGE_END) - 1) {
+                    tail_start = base_offset + consumed + i + 1;
+                    page_ends.push_back(tail_start);
+                    page_end_matched = 0;
+                }
+            }
+            else {
+                page_end_matched = data[i] == '<' ? 1 : 0;
+            }
+        }
+
+        unsigned long long chunk_start = base_offset + consumed;
+        if (tail_start >= chunk_start) {
+            tail_text.clear();
+        }
+
+        size_t tail_index = (size_t) (std::max(tail_start, chunk_start) - chunk_start);
+        if (tail_index < count) {
+            tail_text.append(data + tail_index, count - tail_index);
+        }
+    }
+};
+
+// Reads an XML dump from a file or from stdin ("-"). Zip and gzip archives are inflated on a separate thread, which
+// feeds the parser through a ring buffer, so no extracted copy of the dump is needed.
+//
+// Reading can start at an offset in the uncompressed input; the prefix is then read before it, e.g. to open the root
+// element again.
+class InputStream : public std::istream {
+public:
+    InputStream(const char* path, unsigned long long offset = 0, const std::string& prefix = "", size_t buffer_size = 64 << 20) :
+        std::istream(nullptr), ring_buffer(buffer_size), streambuf(ring_buffer, offset, prefix.length()),
+        offset(offset), prefix(prefix) {
+        rdbuf(&streambuf);
+
+        if (std::string(path) == "-") {
+#ifdef _WIN32
+            _setmode(_fileno(stdin), _O_BINARY);
+#endif
+            source = &std::cin;
+        }
+        else {
+            file.open(path, std::ios::binary);
+            source = &file;
+        }
+
+        if (is_open()) {
+            producer = std::thread(&InputStream::produce, this);
+        }
+        else {
+            setstate(std::ios::failbit);
+        }
+    }
+
+    ~InputStream() {
+        ring_buffer.cancel();
+        if (producer.joinable()) {
+            producer.join();
+        }
+    }
+
+    bool is_open() const {
+        return source != &file || file.is_open();
+    }
+
+    // Rethrows any error that stopped the decompression thread; the parser only sees it as an early end of input
+    void rethrow_error() {
+        ring_buffer.rethrow_error();
+    }
+
+    unsigned long long pop_page_end() {
+        return streambuf.pop_page_end();
+    }
+
+    const std::string& tail() const {
+        return streambuf.tail();
+    }
+
+private:
+    std::ifstream file;
+    std::istream* source;
+    RingBuffer ring_buffer;
+    RingBufferStreambuf streambuf;
+    std::thread producer;
+    unsigned long long offset;
+    std::string prefix;
+
+    void produce() {
+        try {
+            ring_buffer.write(prefix.data(), prefix.length());
+
+            // A plain file starts at the offset right away; archives and stdin have to be read through up to it
+            unsigned long long skipped = seek_to_offset() ? offset : 0;
+            Inflater inflater(*source);
+            auto sink = [this, &skipped](const char* data, size_t size) {
+                if (skipped < offset) {
+                    size_t count = (size_t) std::min<unsigned long long>(size, offset - skipped);
+                    skipped += count;
+                    data += count;
+                    size -= count;
+                }
+                ring_buffer.write(data, size);
+            };
+
+            if (skipped > 0) {
+                inflater.copy(sink);
+            }
+            else {
+                unsigned char signature[2] = { inflater.read_byte(), inflater.read_byte() };
+
+                if (signature[0] == 'P' && signature[1] == 'K') {
+                    read_zip_header(inflater);
+                    inflater.inflate(sink);
+                }
+                else if (signature[0] == 0x1F && signature[1] == 0x8B) {
+                    read_gzip_header(inflater);
+                    inflater.inflate(sink);
+                }
+                else {
+                    sink((const char*) signature, 2);
+                    inflater.copy(sink);
+                }
+            }
+
+            if (skipped < offset) {
+                throw std::runtime_error("The input is shorter than expected");
+            }
+            ring_buffer.close();
+        }
+        catch (RingBuffer::Cancelled&) {
+        }
+        catch (...) {
+            ring_buffer.close(std::current_exception());
+        }
+    }
+
+    // Seeks a file that is not an archive to the offset, and returns whether it did
+    bool seek_to_offset() {
+        if (offset == 0 || source != &file) {
+            return false;
+        }
+
+        // A named pipe cannot seek, and is read through like stdin
+        file.seekg(0, std::ios::end);
+        long long size = file.tellg();
+        file.clear();
+        if (size < 0) {
+            return false;
+        }
+
+        unsigned char signature[2] = {};
+        file.seekg(0);
+        file.read((char*) signature, 2);
+        file.clear();
+        if ((signature[0] == 'P' && signature[1] == 'K') || (signature[0] == 0x1F && signature[1] == 0x8B)) {
+            file.seekg(0);
+            return false;
+        }
+
+        if ((unsigned long long) size < offset) {
+            throw std::runtime_error("The input is shorter than expected");
+        }
+        file.seekg(offset);
+        return true;
+    }
+
+    static unsigned read_integer(Inflater& inflater, int size) {
+        unsigned result = 0;
+        for (int i = 0; i < size; i++) {
+            result |= inflater.read_byte() << (8 * i);
+        }
+        return result;
+    }
+
+    // Only the first entry of a zip archive is read; its data follows the local file header directly
+    static void read_zip_header(Inflater& inflater) {
+        if (read_integer(inflater, 2) != 0x0403) {
+            throw std::runtime_error("Unsupported zip archive");
+        }
+
+        inflater.skip(4); // version and flags
+        unsigned method = read_integer(inflater, 2);
+        inflater.skip(16); // time, date, CRC and sizes
+        unsigned name_length = read_integer(inflater, 2);
+        unsigned extra_length = read_integer(inflater, 2);
+        inflater.skip(name_length + extra_length);
+
+        if (method != 8) {
+            throw std::runtime_error("Only deflated zip entries are supported");
+        }
+    }
+
+    static void read_gzip_header(Inflater& inflater) {
+        const unsigned char FEXTRA = 4, FNAME = 8, FCOMMENT = 16, FHCRC = 2;
+
+        if (inflater.read_byte() != 8) {
+            throw std::runtime_error("Unsupported gzip compression method");
+        }
+
+        unsigned char flags = inflater.read_byte();
+        inflater.skip(6); // modification time, extra flags and OS
+
+        if (flags & FEXTRA) {
+            inflater.skip(read_integer(inflater, 2));
+        }
+        if (flags & FNAME) {
+            while (inflater.read_byte());
+        }
+        if (flags & FCOMMENT) {
+            while (inflater.read_byte());
+        }
+        if (flags & FHCRC) {
+            inflater.skip(2);
+        }
+    }
+};
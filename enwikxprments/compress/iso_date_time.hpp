@@ -5,16 +5,45 @@
 
 #include "xml/parser"
 
+// Timestamps in the dump are in UTC
 struct IsoDateTime {
+    static const size_t LENGTH = 20;
+
     IsoDateTime(time_t time) : time(time) {}
-    IsoDateTime(tm time) : IsoDateTime(mktime(&time)) {}
+    IsoDateTime(tm time) : IsoDateTime(_mkgmtime(&time)) {}
 
     operator time_t() const {
         return time;
     }
 
+    // Writes the LENGTH characters of "YYYY-MM-DDThh:mm:ssZ"
+    static void format(time_t time, char* buffer) {
+        tm time_breakdown;
+        gmtime_s(&time_breakdown, &time);
+
+        write_digits(buffer, 1900 + time_breakdown.tm_year, 4);
+        buffer[4] = '-';
+        write_digits(buffer + 5, 1 + time_breakdown.tm_mon, 2);
+        buffer[7] = '-';
+        write_digits(buffer + 8, time_breakdown.tm_mday, 2);
+        buffer[10] = 'T';
+        write_digits(buffer + 11, time_breakdown.tm_hour, 2);
+        buffer[13] = ':';
+        write_digits(buffer + 14, time_breakdown.tm_min, 2);
+        buffer[16] = ':';
+        write_digits(buffer + 17, time_breakdown.tm_sec, 2);
+        buffer[19] = 'Z';
+    }
+
 private:
     time_t time;
+
+    static void write_digits(char* buffer, int value, int count) {
+        for (int i = count - 1; i >= 0; i--) {
+            buffer[i] = '0' + value % 10;
+            value /= 10;
+        }
+    }
 };
 
 namespace xml
@@ -37,7 +66,9 @@ namespace xml
 
         static std::string serialize(IsoDateTime x, const serializer&)
         {
-            return ""; // TODO
+            char buffer[IsoDateTime::LENGTH];
+            IsoDateTime::format(x, buffer);
+            return std::string(buffer, IsoDateTime::LENGTH);
         }
     };
 }
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cassert>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "verifier.hpp"
+#include "xml_escaping.hpp"
+
+// Collects the output in a large buffer, so that it is written to the file in big blocks. With a verifier the blocks
+// are compared with the original instead of being written.
+class OutputBuffer {
+public:
+    OutputBuffer(const char* path, size_t capacity = 16 << 20) : output(path, std::ios::binary), buffer(capacity) {
+        size = 0;
+        verifier = nullptr;
+    }
+
+    OutputBuffer(Verifier& verifier, size_t capacity = 16 << 20) : buffer(capacity) {
+        size = 0;
+        this->verifier = &verifier;
+    }
+
+    // flush() has to be called at the end, where a failed write can still throw; only an error that is already being
+    // thrown leaves something behind
+    ~OutputBuffer() {
+        assert(size == 0 || std::uncaught_exceptions() > 0);
+    }
+
+    bool is_open() const {
+        return verifier != nullptr || output.is_open();
+    }
+
+    void write(const char* data, size_t count) {
+        if (count > buffer.size() - size) {
+            flush();
+
+            if (count > buffer.size()) {
+                write_through(data, count);
+                return;
+            }
+        }
+
+        memcpy(buffer.data() + size, data, count);
+        size += count;
+    }
+
+    void write(const std::string& text) {
+        write(text.data(), text.length());
+    }
+
+    void put(char c) {
+        if (size == buffer.size()) {
+            flush();
+        }
+        buffer[size++] = c;
+    }
+
+    void write_integer(long long value) {
+        char digits[20];
+        int count = 0;
+        unsigned long long magnitude = value < 0 ? 0 - (unsigned long long) value : value;
+
+        do {
+            digits[sizeof(digits) - ++count] = '0' + magnitude % 10;
+            magnitude /= 10;
+        } while (magnitude > 0);
+
+        if (value < 0) {
+            put('-');
+        }
+        write(digits + sizeof(digits) - count, count);
+    }
+
+    // Writes text with the characters that the dump escapes replaced by entities, in the same way as the extractor
+    void write_escaped(const std::string& text) {
+        writeEscaped(*this, text);
+    }
+
+    void flush() {
+        size_t count = size;
+        size = 0;
+        write_through(buffer.data(), count);
+
+        if (verifier == nullptr && !output.flush()) {
+            throw std::runtime_error("Could not write the output");
+        }
+    }
+
+private:
+    std::ofstream output;
+    Verifier* verifier;
+    std::vector<char> buffer;
+    size_t size;
+
+    void write_through(const char* data, size_t count) {
+        if (verifier != nullptr) {
+            verifier->compare(data, count);
+            return;
+        }
+
+        output.write(data, count);
+        if (!output) {
+            throw std::runtime_error("Could not write the output");
+        }
+    }
+};
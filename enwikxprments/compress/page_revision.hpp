@@ -1,13 +1,24 @@
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
 #include <fstream>
-#include <set>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "xml/parser"
 
+#include "checkpoint.hpp"
+#include "column_reader.hpp"
 #include "contributors.hpp"
+#include "external_sorter.hpp"
+#include "input_stream.hpp"
 #include "iso_date_time.hpp"
+#include "output_buffer.hpp"
 #include "restrictions.hpp"
 
 struct PageRevision {
@@ -22,81 +33,302 @@ struct PageRevision {
     std::string revision_text;
 };
 
-class PageRevisions {
+// The fixed-size fields of a page revision, stored one after the other in out/page_revisions like the extractor
+// expects them
+#pragma pack(push, 1)
+struct PageRevisionRecord {
+    int page_id;
+    Restrictions page_restrictions;
+    int revision_id;
+    long long revision_timestamp;
+    int contributor_index;
+    bool revision_minor;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(PageRevisionRecord) == 22, "The extractor reads 22 byte records");
+
+// The files in out/ that hold the page revisions
+struct PageRevisionColumns {
+    // CONTRIBUTOR holds the contributors themselves while parsing; once the dictionaries are complete, their indices
+    // are filled into the records and the column is removed
+    enum Column { TITLE, COMMENT, TEXT, RECORD, CONTRIBUTOR };
+    static const int COLUMN_COUNT = 5;
+
+    static constexpr const char* COLUMN_PATHS[COLUMN_COUNT] = {
+        "out/page_revisions_title",
+        "out/page_revisions_comment",
+        "out/page_revisions_text",
+        "out/page_revisions",
+        "out/page_revisions_contributor",
+    };
+
+    // Whatever follows the last complete page in the dump. The first byte is 1 if the dump is cut off inside the text
+    // of its last page (as enwik8 and enwik9 are); that page is then also kept as the last record, like the extractor
+    // expects it, but it is written back from the tail.
+    static constexpr const char* TAIL_PATH = "out/tail";
+};
+
+// Writes the columns of the page revisions as they are parsed. A contributor's index is not known until all of them
+// have been seen, so the contributors are written out as they are and resolve_contributors() fills the indices in.
+class PageRevisionWriter : private PageRevisionColumns {
 public:
-    void emplace_back(PageRevision& page_revistion) {
-        page_revisions.emplace_back(page_revistion);
+    // Continues the columns from the given positions, dropping anything that was written after them
+    PageRevisionWriter(const std::vector<unsigned long long>& positions = std::vector<unsigned long long>()) {
+        for (int i = 0; i < COLUMN_COUNT; i++) {
+            if (positions.empty()) {
+                columns[i].open(COLUMN_PATHS[i], std::ios::binary);
+            }
+            else {
+                std::filesystem::resize_file(COLUMN_PATHS[i], positions.at(i));
+                columns[i].open(COLUMN_PATHS[i], std::ios::binary | std::ios::app);
+            }
+        }
     }
 
-    PageRevision& back() {
-        return page_revisions.back();
+    void write(const PageRevision& page_revision) {
+        columns[TITLE].write(page_revision.page_title.c_str(), page_revision.page_title.length() + 1);
+        columns[COMMENT].write(page_revision.revision_comment.c_str(), page_revision.revision_comment.length() + 1);
+        columns[TEXT].write(page_revision.revision_text.c_str(), page_revision.revision_text.length() + 1);
+
+        PageRevisionRecord record;
+        record.page_id = page_revision.page_id;
+        record.page_restrictions = page_revision.page_restrictions;
+        record.revision_id = page_revision.revision_id;
+        record.revision_timestamp = page_revision.revision_timestamp;
+        record.contributor_index = -1;
+        record.revision_minor = page_revision.revision_minor;
+        columns[RECORD].write((char*)&record, sizeof(record));
+
+        write_contributor(*page_revision.contributor);
     }
 
-    void read_binary() {
-        std::vector<ContributorWithUsername> with_username;
-        std::vector<ContributorWithIpAddress> with_ip_address;
-        std::vector<ContributorWithIpString> with_ip_string;
+    // Flushes the columns to disk and returns their lengths
+    std::vector<unsigned long long> positions() {
+        std::vector<unsigned long long> result;
 
-        std::ifstream username_id_input("out/contributors_with_username_id", std::ios::binary);
-        std::ifstream username_username_input("out/contributors_with_username_username", std::ios::binary);
-        while (username_id_input.eof() == false) {
-            ContributorWithUsername contributor;
-            username_id_input.read((char*)&contributor.id, sizeof(contributor.id));
-            username_username_input >> contributor.username;
-            with_username.push_back(contributor);
+        for (int i = 0; i < COLUMN_COUNT; i++) {
+            if (!columns[i].flush()) {
+                throw std::runtime_error((std::string) "Could not write '" + COLUMN_PATHS[i] + "'");
+            }
+            sync_file(COLUMN_PATHS[i]);
+            result.push_back(columns[i].tellp());
         }
-        contributors.swap(with_username);
 
-        std::ifstream ip_address_output("out/contributors_with_ip_address", std::ios::binary);
-        while (ip_address_output.eof() == false) {
-            ContributorWithIpAddress contributor;
-            ip_address_output.read((char*)&contributor.ip, sizeof(contributor.ip));
-            with_ip_address.push_back(contributor);
+        return result;
+    }
+
+    void close() {
+        for (int i = 0; i < COLUMN_COUNT; i++) {
+            columns[i].close();
         }
-        contributors.swap(with_ip_address);
+    }
+
+    // Fills the contributors' indices in the finished dictionaries into the records
+    static void resolve_contributors(const Contributors& contributors) {
+        std::string resolved_path = (std::string) COLUMN_PATHS[RECORD] + ".tmp";
 
-        std::ifstream ip_string_output("out/contributors_with_ip_string", std::ios::binary);
-        while (ip_string_output.eof() == false) {
+        {
+            ColumnReader record_input(COLUMN_PATHS[RECORD]);
+            std::ifstream contributor_input(COLUMN_PATHS[CONTRIBUTOR], std::ios::binary);
+            std::ofstream record_output(resolved_path, std::ios::binary);
+            PageRevisionRecord record;
+            char type;
+
+            while (record_input.read(record) && contributor_input.get(type)) {
+                record.contributor_index = read_contributor_index(contributor_input, (ContributorType) type, contributors);
+                record_output.write((char*)&record, sizeof(record));
+            }
+
+            if (!record_output.flush()) {
+                throw std::runtime_error("Could not write '" + resolved_path + "'");
+            }
+        }
+
+        std::filesystem::rename(resolved_path, COLUMN_PATHS[RECORD]);
+        std::remove(COLUMN_PATHS[CONTRIBUTOR]);
+    }
+
+private:
+    std::ofstream columns[COLUMN_COUNT];
+
+    void write_contributor(const Contributor& contributor) {
+        std::ofstream& output = columns[CONTRIBUTOR];
+
+        if (auto c = dynamic_cast<const ContributorWithUsername*>(&contributor)) {
+            output.put(USERNAME);
+            c->write(output);
+        }
+        else if (auto c = dynamic_cast<const ContributorWithIpAddress*>(&contributor)) {
+            output.put(IP_ADDRESS);
+            c->write(output);
+        }
+        else if (auto c = dynamic_cast<const ContributorWithIpRange*>(&contributor)) {
+            output.put(IP_RANGE);
+            c->write(output);
+        }
+        else if (auto c = dynamic_cast<const ContributorWithIpString*>(&contributor)) {
+            output.put(IP_STRING);
+            c->write(output);
+        }
+        else {
+            throw std::invalid_argument("Unsupported contributor type");
+        }
+    }
+
+    static int read_contributor_index(std::istream& input, ContributorType type, const Contributors& contributors) {
+        switch (type) {
+        case IP_ADDRESS: {
+            ContributorWithIpAddress contributor;
+            contributor.read(input);
+            return contributors.get_index(contributor);
+        }
+        case IP_RANGE: {
+            ContributorWithIpRange contributor;
+            contributor.read(input);
+            return contributors.get_index(contributor);
+        }
+        case IP_STRING: {
             ContributorWithIpString contributor;
-            ip_string_output >> contributor.address;
-            with_ip_string.push_back(contributor);
+            contributor.read(input);
+            return contributors.get_index(contributor);
         }
-        contributors.swap(with_ip_string);
+        default: {
+            ContributorWithUsername contributor;
+            contributor.read(input);
+            return contributors.get_index(contributor);
+        }
+        }
+    }
+};
+
+// Reads the page revisions back from their columns, one at a time
+class PageRevisionReader : private PageRevisionColumns {
+public:
+    PageRevisionReader() :
+        title(COLUMN_PATHS[TITLE]),
+        comment(COLUMN_PATHS[COMMENT]),
+        text(COLUMN_PATHS[TEXT]),
+        record(COLUMN_PATHS[RECORD]) {
+    }
 
-        std::ifstream page_revisions_page_id_input("out/page_revisions_page_id", std::ios::binary);
-        std::ifstream page_revisions_page_restrictions_input("out/page_revisions_page_restrictions", std::ios::binary);
-        std::ifstream page_revisions_revision_id_input("out/page_revisions_revision_id", std::ios::binary);
-        std::ifstream page_revisions_revision_timestamp_input("out/page_revisions_revision_timestamp", std::ios::binary);
-        std::ifstream page_revisions_contributor_index_input("out/page_revisions_contributor_index", std::ios::binary);
+    bool is_open() const {
+        return title.is_open() && comment.is_open() && text.is_open() && record.is_open();
+    }
 
-        std::ifstream page_revisions_title_input("out/page_revisions_title", std::ios::binary);
-        std::ifstream page_revisions_comment_input("out/page_revisions_comment", std::ios::binary);
-        std::ifstream page_revisions_text_input("out/page_revisions_text", std::ios::binary);
+    static unsigned long long count() {
+        return std::filesystem::file_size(COLUMN_PATHS[RECORD]) / sizeof(PageRevisionRecord);
+    }
 
-        page_revisions.clear();
-        while (page_revisions_page_id_input.eof() == false) {
-            PageRevision page_revision;
-            page_revisions_title_input >> page_revision.page_title;
-            page_revisions_comment_input >> page_revision.revision_comment;
-            page_revisions_text_input >> page_revision.revision_text;
+    // The contributor is not looked up; its index in the dictionaries is returned instead
+    bool read(PageRevision& page_revision, int& contributor_index) {
+        PageRevisionRecord fields;
+        if (!record.read(fields)) {
+            return false;
+        }
 
-            page_revisions_page_id_input.read((char*)&page_revision.page_id, sizeof(page_revision.page_id));
-            page_revisions_page_restrictions_input.read((char*)&page_revision.page_restrictions, sizeof(page_revision.page_restrictions));
-            page_revisions_revision_id_input.read((char*)&page_revision.revision_id, sizeof(page_revision.revision_id));
-            page_revisions_revision_timestamp_input.read((char*)&page_revision.revision_timestamp, sizeof(page_revision.revision_timestamp));
+        page_revision.page_id = fields.page_id;
+        page_revision.page_restrictions = fields.page_restrictions;
+        page_revision.revision_id = fields.revision_id;
+        page_revision.revision_timestamp = fields.revision_timestamp;
+        page_revision.revision_minor = fields.revision_minor;
+        contributor_index = fields.contributor_index;
 
-            size_t contributor_index;
-            page_revisions_contributor_index_input.read((char*)&contributor_index, sizeof(contributor_index));
-            page_revision.contributor = contributors.get(contributor_index);
+        bool complete = title.read(page_revision.page_title) &&
+            comment.read(page_revision.revision_comment) &&
+            text.read(page_revision.revision_text);
 
-            page_revisions.push_back(page_revision);
+        if (!complete) {
+            throw std::runtime_error("The page revision columns have different lengths");
         }
+        return true;
+    }
+
+private:
+    ColumnReader title;
+    ColumnReader comment;
+    ColumnReader text;
+    ColumnReader record;
+};
+
+struct CompressOptions {
+    // With a non-zero max_memory (in bytes) the contributor dictionaries are built with sorted runs spilled to disk
+    size_t max_memory = 0;
+
+    // A checkpoint is saved after every checkpoint_pages pages and/or every checkpoint_minutes minutes (0 for never)
+    unsigned long long checkpoint_pages = 0;
+    unsigned checkpoint_minutes = 0;
+
+    // Continues from the last checkpoint, if there is one
+    bool resume = false;
+};
+
+class PageRevisions {
+public:
+    PageRevisions(const CompressOptions& options = CompressOptions()) :
+        options(options),
+        with_ip_address("out/contributors_with_ip_address", options.max_memory / 4),
+        with_ip_range("out/contributors_with_ip_range", options.max_memory / 4),
+        with_ip_string("out/contributors_with_ip_string", options.max_memory / 4),
+        with_username("out/contributors_with_username", options.max_memory / 4) {
     }
 
-    void write_binary() const {
+    // Loads the dictionaries; the page revisions themselves are streamed by write_xml()
+    void read_binary() {
+        std::vector<ContributorWithUsername> with_username;
+        std::vector<ContributorWithIpAddress> with_ip_address;
+        std::vector<ContributorWithIpRange> with_ip_range;
+        std::vector<ContributorWithIpString> with_ip_string;
+
+        ColumnReader username_id_input("out/contributors_with_username_id");
+        ColumnReader username_username_input("out/contributors_with_username_username");
+        ContributorWithUsername username_contributor;
+        while (username_id_input.read(username_contributor.id) && username_username_input.read(username_contributor.username)) {
+            with_username.push_back(username_contributor);
+        }
+        contributors.swap(with_username);
+
+        ColumnReader ip_address_input("out/contributors_with_ip_address");
+        ContributorWithIpAddress ip_address_contributor;
+        while (ip_address_input.read(ip_address_contributor.ip)) {
+            with_ip_address.push_back(ip_address_contributor);
+        }
+        contributors.swap(with_ip_address);
+
+        ColumnReader ip_range_input("out/contributors_with_ip_range");
+        ContributorWithIpRange ip_range_contributor;
+        while (ip_range_input.read(ip_range_contributor.components)) {
+            with_ip_range.push_back(ip_range_contributor);
+        }
+        contributors.swap(with_ip_range);
+
+        ColumnReader ip_string_input("out/contributors_with_ip_string");
+        ContributorWithIpString ip_string_contributor;
+        while (ip_string_input.read(ip_string_contributor.address)) {
+            with_ip_string.push_back(ip_string_contributor);
+        }
+        contributors.swap(with_ip_string);
+    }
+
+    // Finishes what read_xml() started: writes the dictionaries and the contributor indices of the page revisions
+    void write_binary() {
+        std::vector<ContributorWithIpAddress> with_ip_address_vector;
+        with_ip_address.merge([&](const ContributorWithIpAddress& contributor) { with_ip_address_vector.push_back(contributor); });
+        contributors.swap(with_ip_address_vector);
+        std::vector<ContributorWithIpRange> with_ip_range_vector;
+        with_ip_range.merge([&](const ContributorWithIpRange& contributor) { with_ip_range_vector.push_back(contributor); });
+        contributors.swap(with_ip_range_vector);
+        std::vector<ContributorWithIpString> with_ip_string_vector;
+        with_ip_string.merge([&](const ContributorWithIpString& contributor) { with_ip_string_vector.push_back(contributor); });
+        contributors.swap(with_ip_string_vector);
+        std::vector<ContributorWithUsername> with_username_vector;
+        with_username.merge([&](const ContributorWithUsername& contributor) { with_username_vector.push_back(contributor); });
+        contributors.swap(with_username_vector);
+
         std::ofstream username_id_output("out/contributors_with_username_id", std::ios::binary);
         std::ofstream username_username_output("out/contributors_with_username_username", std::ios::binary);
         std::ofstream ip_address_output("out/contributors_with_ip_address", std::ios::binary);
+        std::ofstream ip_range_output("out/contributors_with_ip_range", std::ios::binary);
         std::ofstream ip_string_output("out/contributors_with_ip_string", std::ios::binary);
 
         for (auto contributor : contributors.with_username) {
@@ -108,66 +340,81 @@ public:
             ip_address_output.write((char*)&contributor.ip, sizeof(contributor.ip));
         }
 
+        for (auto contributor : contributors.with_ip_range) {
+            ip_range_output.write((char*)contributor.components, sizeof(contributor.components));
+        }
+
         for (auto contributor : contributors.with_ip_string) {
             ip_string_output.write(contributor.address.c_str(), contributor.address.length() + 1);
         }
 
-        std::ofstream page_revisions_page_id_output("out/page_revisions_page_id", std::ios::binary);
-        std::ofstream page_revisions_page_restrictions_output("out/page_revisions_page_restrictions", std::ios::binary);
-        std::ofstream page_revisions_revision_id_output("out/page_revisions_revision_id", std::ios::binary);
-        std::ofstream page_revisions_revision_timestamp_output("out/page_revisions_revision_timestamp", std::ios::binary);
-        std::ofstream page_revisions_contributor_index_output("out/page_revisions_contributor_index", std::ios::binary);
-        std::ofstream page_revisions_title_output("out/page_revisions_title", std::ios::binary);
-        std::ofstream page_revisions_revision_minor_output("out/page_revisions_revision_minor", std::ios::binary);
-        std::ofstream page_revisions_comment_output("out/page_revisions_comment", std::ios::binary);
-        std::ofstream page_revisions_text_output("out/page_revisions_text", std::ios::binary);
-
-        for (auto page_revision : this->page_revisions) {
-            page_revisions_title_output.write(page_revision.page_title.c_str(), page_revision.page_title.length() + 1);
-            page_revisions_revision_minor_output.write((char*)&page_revision.revision_minor, 1);
-            page_revisions_comment_output.write(page_revision.revision_comment.c_str(), page_revision.revision_comment.length() + 1);
-            page_revisions_text_output.write(page_revision.revision_text.c_str(), page_revision.revision_text.length() + 1);
+        PageRevisionWriter::resolve_contributors(contributors);
 
-            page_revisions_page_id_output.write((char*)&page_revision.page_id, sizeof(page_revision.page_id));
-            page_revisions_page_restrictions_output.write((char*)&page_revision.page_restrictions, sizeof(page_revision.page_restrictions));
-            page_revisions_revision_id_output.write((char*)&page_revision.revision_id, sizeof(page_revision.revision_id));
-            page_revisions_revision_timestamp_output.write((char*)&page_revision.revision_timestamp, sizeof(page_revision.revision_timestamp));
-
-            const Contributor& contributor = *page_revision.contributor;
-            size_t contributor_index = contributors.get_index(contributor);
-            page_revisions_contributor_index_output.write((char*)&contributor_index, sizeof(contributor_index));
-        }
+        Checkpoint::remove(CHECKPOINT_PATH);
+        with_ip_address.clear();
+        with_ip_range.clear();
+        with_ip_string.clear();
+        with_username.clear();
     }
 
+    // Parses the dump and writes the page revision columns as it goes; the dictionaries are written by write_binary()
     void read_xml(const char* filename) {
         const char* ns = "http://www.mediawiki.org/xml/export-0.3/";
 
-        std::ifstream input(filename);
+        Checkpoint checkpoint;
+        bool resuming = options.resume && checkpoint.load(CHECKPOINT_PATH);
+
+        if (options.resume && !resuming) {
+            std::cout << "No checkpoint found, starting from the beginning" << std::endl;
+        }
+
+        // Parsing restarts after the last saved page, inside a fresh root element
+        InputStream input(filename,
+            resuming ? checkpoint.input_offset : 0,
+            resuming ? (std::string) "<mediawiki xmlns=\"" + ns + "\">" : "");
 
         if (!input.is_open()) {
             auto message = (std::string) "Could not open '" + filename + "'";
             throw std::invalid_argument(message);
         }
 
+        std::unique_ptr<PageRevisionWriter> writer;
+        unsigned long long page_count = 0;
+
+        if (resuming) {
+            writer.reset(new PageRevisionWriter(checkpoint.column_positions));
+            with_ip_address.restore_state(checkpoint.dictionaries.at(0));
+            with_ip_range.restore_state(checkpoint.dictionaries.at(1));
+            with_ip_string.restore_state(checkpoint.dictionaries.at(2));
+            with_username.restore_state(checkpoint.dictionaries.at(3));
+            page_count = checkpoint.page_count;
+        }
+        else {
+            writer.reset(new PageRevisionWriter());
+        }
+
+        auto last_checkpoint_time = std::chrono::steady_clock::now();
         PageRevision page_revision;
-        std::set<ContributorWithIpAddress> with_ip_address;
-        std::set<ContributorWithIpString> with_ip_string;
-        std::set<ContributorWithUsername> with_username;
+        bool reading_text = false;
+        bool cut_off_in_text = false;
 
         try {
             xml::parser enwik_parser(input, filename);
 
             enwik_parser.next_expect(xml::parser::event_type::start_element, ns, "mediawiki", xml::content::complex);
-            enwik_parser.next_expect(xml::parser::event_type::start_element, ns, "siteinfo", xml::content::complex);
 
-            for (auto value_type : enwik_parser) {
-                auto x = enwik_parser.name();
-                auto y = value_type;
-                if (enwik_parser.name() == "namespace" && value_type == xml::parser::event_type::start_element) {
-                    enwik_parser.attribute("key");
-                }
-                if (enwik_parser.name() == "siteinfo" && value_type == xml::parser::event_type::end_element) {
-                    break;
+            if (!resuming) {
+                enwik_parser.next_expect(xml::parser::event_type::start_element, ns, "siteinfo", xml::content::complex);
+
+                for (auto value_type : enwik_parser) {
+                    auto x = enwik_parser.name();
+                    auto y = value_type;
+                    if (enwik_parser.name() == "namespace" && value_type == xml::parser::event_type::start_element) {
+                        enwik_parser.attribute("key");
+                    }
+                    if (enwik_parser.name() == "siteinfo" && value_type == xml::parser::event_type::end_element) {
+                        break;
+                    }
                 }
             }
 
@@ -221,21 +468,26 @@ public:
                                 enwik_parser.next_expect(xml::parser::event_type::end_element);
 
                                 ContributorWithUsername contributor(id, username);
-                                with_username.emplace(contributor);
+                                with_username.push(contributor);
                                 page_revision.contributor.reset(new ContributorWithUsername(contributor));
                             }
                             else if (enwik_parser.name() == "ip") {
                                 std::string text_element = enwik_parser.element();
-                                IP ip;
+                                ContributorWithIpAddress ip_address_contributor;
+                                ContributorWithIpRange ip_range_contributor;
 
-                                if (sscanf_s(text_element.c_str(), "%hhu.%hhu.%hhu.%hhu", ip.components, ip.components + 1, ip.components + 2, ip.components + 3) == 4) {
-                                    ContributorWithIpAddress contributor(ip);
-                                    with_ip_address.emplace(contributor);
-                                    page_revision.contributor.reset(new ContributorWithIpAddress(contributor));
+                                // Anything that would not be written back byte for byte is kept as a string
+                                if (ContributorWithIpAddress::parse(text_element, ip_address_contributor)) {
+                                    with_ip_address.push(ip_address_contributor);
+                                    page_revision.contributor.reset(new ContributorWithIpAddress(ip_address_contributor));
+                                }
+                                else if (ContributorWithIpRange::parse(text_element, ip_range_contributor)) {
+                                    with_ip_range.push(ip_range_contributor);
+                                    page_revision.contributor.reset(new ContributorWithIpRange(ip_range_contributor));
                                 }
                                 else {
                                     ContributorWithIpString contributor(text_element);
-                                    with_ip_string.emplace(contributor);
+                                    with_ip_string.push(contributor);
                                     page_revision.contributor.reset(new ContributorWithIpString(contributor));
                                 }
                             }
@@ -251,44 +503,330 @@ public:
                         }
 
                         if (enwik_parser.name() == "comment") {
-                            enwik_parser.next_expect(xml::parser::event_type::characters);
                             page_revision.revision_comment = enwik_parser.element();
                             enwik_parser.next_expect(xml::parser::event_type::start_element);
                         }
 
                         if (enwik_parser.name() == "text") {
                             for (const auto& attribute_name : enwik_parser.attribute_map()); // Consume attributes
+                            reading_text = true;
                             page_revision.revision_text = enwik_parser.element();
+                            reading_text = false;
                         }
                     }
                     enwik_parser.next_expect(xml::parser::event_type::end_element);
                 }
 
-                page_revisions.emplace_back(page_revision);
+                writer->write(page_revision);
 
                 enwik_parser.next_expect(xml::parser::event_type::end_element);
+
+                unsigned long long page_end = input.pop_page_end();
+                page_count++;
+
+                bool checkpoint_due = options.checkpoint_pages > 0 && page_count % options.checkpoint_pages == 0;
+                if (options.checkpoint_minutes > 0 && std::chrono::steady_clock::now() - last_checkpoint_time >= std::chrono::minutes(options.checkpoint_minutes)) {
+                    checkpoint_due = true;
+                }
+
+                if (checkpoint_due) {
+                    save_checkpoint(*writer, page_count, page_end);
+                    last_checkpoint_time = std::chrono::steady_clock::now();
+                }
             } while (enwik_parser.peek() == xml::parser::event_type::start_element);
         }
         catch (xml::parsing& error) {
+            input.rethrow_error();
+
+            // A dump that is cut off in the middle of a page (like enwik8 and enwik9) ends up in the tail
             if (input.tellg() != EOF) {
                 throw;
             }
-            page_revisions.emplace_back(page_revision);
+            cut_off_in_text = reading_text;
         }
 
-        std::vector<ContributorWithIpAddress> with_ip_address_vector(with_ip_address.begin(), with_ip_address.end());
-        contributors.swap(with_ip_address_vector);
-        std::vector<ContributorWithIpString> with_ip_string_vector(with_ip_string.begin(), with_ip_string.end());
-        contributors.swap(with_ip_string_vector);
-        std::vector<ContributorWithUsername> with_username_vector(with_username.begin(), with_username.end());
-        contributors.swap(with_username_vector);
+        input.ignore(std::numeric_limits<std::streamsize>::max());
+        input.rethrow_error();
+
+        // The extractor also gets the page that the dump is cut off in, with as much of its text as there is
+        if (cut_off_in_text) {
+            page_revision.revision_text = read_partial_text(input.tail());
+            writer->write(page_revision);
+        }
+        writer->close();
+
+        std::ofstream tail_output(PageRevisionColumns::TAIL_PATH, std::ios::binary);
+        tail_output.put(cut_off_in_text ? 1 : 0);
+        tail_output.write(input.tail().data(), input.tail().length());
     }
 
+    // Reproduces the original dump, streaming one page revision at a time from the columns
     void write_xml(const char* filepath) {
-        throw std::exception("Not implemented"); // TODO: implement
+        OutputBuffer output(filepath);
+        if (!output.is_open()) {
+            auto message = (std::string) "Could not open '" + filepath + "'";
+            throw std::invalid_argument(message);
+        }
+
+        write_xml(output);
+    }
+
+    // Reproduces the dump in memory and compares it with the original as it goes, so nothing is written to disk.
+    // Throws VerificationError at the first difference; returns the size of the dump.
+    size_t verify_xml(const char* original_path) {
+        Verifier verifier(original_path);
+        OutputBuffer output(verifier);
+
+        write_xml(output);
+        verifier.finish();
+
+        return verifier.size();
     }
 
 private:
-    std::vector<PageRevision> page_revisions;
+    static constexpr const char* CHECKPOINT_PATH = "out/checkpoint";
+
     Contributors contributors;
+    CompressOptions options;
+
+    ExternalSorter<ContributorWithIpAddress> with_ip_address;
+    ExternalSorter<ContributorWithIpRange> with_ip_range;
+    ExternalSorter<ContributorWithIpString> with_ip_string;
+    ExternalSorter<ContributorWithUsername> with_username;
+
+    void write_xml(OutputBuffer& output) {
+        PageRevisionReader reader;
+        if (!reader.is_open()) {
+            throw std::runtime_error("Could not open the page revisions in out/");
+        }
+
+        std::ifstream tail_input(PageRevisionColumns::TAIL_PATH, std::ios::binary);
+        char cut_off_in_text = 0;
+        tail_input.get(cut_off_in_text);
+
+        write_header(output);
+
+        // The page that the dump is cut off in is written back as it is in the tail
+        unsigned long long count = reader.count() - (cut_off_in_text ? 1 : 0);
+        PageRevision page_revision;
+        int contributor_index;
+        for (unsigned long long i = 0; i < count && reader.read(page_revision, contributor_index); i++) {
+            write_page(output, page_revision, contributor_index);
+        }
+
+        output.write(std::string(std::istreambuf_iterator<char>(tail_input), std::istreambuf_iterator<char>()));
+        output.flush();
+    }
+
+    void save_checkpoint(PageRevisionWriter& writer, unsigned long long page_count, unsigned long long input_offset) {
+        Checkpoint checkpoint;
+        checkpoint.page_count = page_count;
+        checkpoint.input_offset = input_offset;
+        checkpoint.column_positions = writer.positions();
+        checkpoint.dictionaries.push_back(with_ip_address.save_state());
+        checkpoint.dictionaries.push_back(with_ip_range.save_state());
+        checkpoint.dictionaries.push_back(with_ip_string.save_state());
+        checkpoint.dictionaries.push_back(with_username.save_state());
+
+        for (const ExternalSorterState& dictionary : checkpoint.dictionaries) {
+            for (const std::string& run_path : dictionary.run_paths) {
+                sync_file(run_path);
+            }
+        }
+
+        checkpoint.save(CHECKPOINT_PATH);
+
+        with_ip_address.commit_state(checkpoint.dictionaries[0]);
+        with_ip_range.commit_state(checkpoint.dictionaries[1]);
+        with_ip_string.commit_state(checkpoint.dictionaries[2]);
+        with_username.commit_state(checkpoint.dictionaries[3]);
+    }
+
+    // The text of a page that the dump is cut off in is whatever follows its <text> tag in the tail. An entity that is
+    // cut off is dropped.
+    static std::string read_partial_text(const std::string& tail) {
+        size_t text_start = tail.rfind("<text");
+        text_start = text_start == std::string::npos ? text_start : tail.find('>', text_start);
+        if (text_start == std::string::npos) {
+            throw std::runtime_error("The dump is cut off outside of a text element");
+        }
+
+        static const char* ENTITIES[][2] = { { "&quot;", "\"" }, { "&amp;", "&" }, { "&lt;", "<" }, { "&gt;", ">" } };
+        std::string result;
+
+        for (size_t i = text_start + 1; i < tail.length(); i++) {
+            if (tail[i] != '&') {
+                result.push_back(tail[i]);
+                continue;
+            }
+
+            size_t entity_end = tail.find(';', i);
+            if (entity_end == std::string::npos) {
+                break;
+            }
+
+            std::string entity = tail.substr(i, entity_end - i + 1);
+            auto match = std::find_if(std::begin(ENTITIES), std::end(ENTITIES), [&](const char* const* e) { return entity == e[0]; });
+            if (match == std::end(ENTITIES)) {
+                throw std::runtime_error("Unsupported entity '" + entity + "'");
+            }
+
+            result += (*match)[1];
+            i = entity_end;
+        }
+
+        return result;
+    }
+
+    // The site info of the enwik dumps, which is not stored
+    static void write_header(OutputBuffer& output) {
+        static const char HEADER[] =
+            "<mediawiki xmlns=\"http://www.mediawiki.org/xml/export-0.3/\" xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\" "
+                "xsi:schemaLocation=\"http://www.mediawiki.org/xml/export-0.3/ http://www.mediawiki.org/xml/export-0.3.xsd\" "
+                "version=\"0.3\" xml:lang=\"en\">\n"
+            "  <siteinfo>\n"
+            "    <sitename>Wikipedia</sitename>\n"
+            "    <base>http://en.wikipedia.org/wiki/Main_Page</base>\n"
+            "    <generator>MediaWiki 1.6alpha</generator>\n"
+            "    <case>first-letter</case>\n"
+            "      <namespaces>\n" // This is a special case in the enwik dataset
+            "      <namespace key=\"-2\">Media</namespace>\n"
+            "      <namespace key=\"-1\">Special</namespace>\n"
+            "      <namespace key=\"0\" />\n"
+            "      <namespace key=\"1\">Talk</namespace>\n"
+            "      <namespace key=\"2\">User</namespace>\n"
+            "      <namespace key=\"3\">User talk</namespace>\n"
+            "      <namespace key=\"4\">Wikipedia</namespace>\n"
+            "      <namespace key=\"5\">Wikipedia talk</namespace>\n"
+            "      <namespace key=\"6\">Image</namespace>\n"
+            "      <namespace key=\"7\">Image talk</namespace>\n"
+            "      <namespace key=\"8\">MediaWiki</namespace>\n"
+            "      <namespace key=\"9\">MediaWiki talk</namespace>\n"
+            "      <namespace key=\"10\">Template</namespace>\n"
+            "      <namespace key=\"11\">Template talk</namespace>\n"
+            "      <namespace key=\"12\">Help</namespace>\n"
+            "      <namespace key=\"13\">Help talk</namespace>\n"
+            "      <namespace key=\"14\">Category</namespace>\n"
+            "      <namespace key=\"15\">Category talk</namespace>\n"
+            "      <namespace key=\"100\">Portal</namespace>\n"
+            "      <namespace key=\"101\">Portal talk</namespace>\n"
+            "    </namespaces>\n"
+            "  </siteinfo>";
+
+        output.write(HEADER, sizeof(HEADER) - 1);
+    }
+
+    // Every page starts on a new line; the line break after the last one is part of the tail
+    void write_page(OutputBuffer& output, const PageRevision& page_revision, int contributor_index) const {
+        write_literal(output, "\n  <page>\n");
+        write_element(output, "    ", "title", page_revision.page_title);
+        write_integer_element(output, "    ", "id", page_revision.page_id);
+
+        if (page_revision.page_restrictions != Restrictions::NONE) {
+            write_element(output, "    ", "restrictions", format_restrictions(page_revision.page_restrictions));
+        }
+
+        write_literal(output, "    <revision>\n");
+        write_integer_element(output, "      ", "id", page_revision.revision_id);
+
+        char timestamp[IsoDateTime::LENGTH];
+        IsoDateTime::format(page_revision.revision_timestamp, timestamp);
+        write_literal(output, "      <timestamp>");
+        output.write(timestamp, IsoDateTime::LENGTH);
+        write_literal(output, "</timestamp>\n");
+
+        write_literal(output, "      <contributor>\n");
+        write_contributor(output, contributor_index);
+        write_literal(output, "      </contributor>\n");
+
+        if (page_revision.revision_minor) {
+            write_literal(output, "      <minor />\n");
+        }
+        if (!page_revision.revision_comment.empty()) {
+            write_element(output, "      ", "comment", page_revision.revision_comment);
+        }
+
+        if (page_revision.revision_text.empty()) {
+            write_literal(output, "      <text xml:space=\"preserve\" />\n");
+        }
+        else {
+            write_literal(output, "      <text xml:space=\"preserve\">");
+            output.write_escaped(page_revision.revision_text);
+            write_literal(output, "</text>\n");
+        }
+
+        write_literal(output, "    </revision>\n");
+        write_literal(output, "  </page>");
+    }
+
+    void write_contributor(OutputBuffer& output, int index) const {
+        const char* indentation = "        ";
+        size_t local_index = index >> 2;
+
+        switch (index & 3) {
+        case IP_ADDRESS:
+            write_ip(output, indentation, contributors.with_ip_address.at(local_index).ip.components, 4, nullptr);
+            break;
+        case IP_RANGE:
+            write_ip(output, indentation, contributors.with_ip_range.at(local_index).components, 3, ".xxx");
+            break;
+        case IP_STRING:
+            write_element(output, indentation, "ip", contributors.with_ip_string.at(local_index).address);
+            break;
+        default:
+            const ContributorWithUsername& contributor = contributors.with_username.at(local_index);
+            write_element(output, indentation, "username", contributor.username);
+            write_integer_element(output, indentation, "id", contributor.id);
+            break;
+        }
+    }
+
+    static void write_ip(OutputBuffer& output, const char* indentation, const unsigned char* components, int count, const char* suffix) {
+        output.write(indentation, strlen(indentation));
+        write_literal(output, "<ip>");
+        for (int i = 0; i < count; i++) {
+            if (i > 0) {
+                output.put('.');
+            }
+            output.write_integer(components[i]);
+        }
+        if (suffix != nullptr) {
+            output.write(suffix, strlen(suffix));
+        }
+        write_literal(output, "</ip>\n");
+    }
+
+    template <size_t N>
+    static void write_literal(OutputBuffer& output, const char (&literal)[N]) {
+        output.write(literal, N - 1);
+    }
+
+    // Empty elements are written as <name />
+    static void write_element(OutputBuffer& output, const char* indentation, const char* name, const std::string& value) {
+        output.write(indentation, strlen(indentation));
+        output.put('<');
+        output.write(name, strlen(name));
+
+        if (value.empty()) {
+            write_literal(output, " />\n");
+            return;
+        }
+
+        output.put('>');
+        output.write_escaped(value);
+        write_literal(output, "</");
+        output.write(name, strlen(name));
+        write_literal(output, ">\n");
+    }
+
+    static void write_integer_element(OutputBuffer& output, const char* indentation, const char* name, long long value) {
+        output.write(indentation, strlen(indentation));
+        output.put('<');
+        output.write(name, strlen(name));
+        output.put('>');
+        output.write_integer(value);
+        write_literal(output, "</");
+        output.write(name, strlen(name));
+        write_literal(output, ">\n");
+    }
 };
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdexcept>
 #include <string>
 
 #include "xml/parser"
@@ -16,6 +17,21 @@ enum class Restrictions: unsigned char {
     SYSOP,
 };
 
+inline const char* format_restrictions(Restrictions restrictions) {
+    switch (restrictions) {
+    case Restrictions::NONE: return "";
+    case Restrictions::EDIT_SYSOP_MOVE_SYSOP: return "edit=sysop:move=sysop";
+    case Restrictions::MOVE_SYSOP_EDIT_SYSOP: return "move=sysop:edit=sysop";
+    case Restrictions::MOVE_EDIT: return "move=:edit=";
+    case Restrictions::MOVE_SYSOP: return "move=sysop";
+    case Restrictions::MOVE_AUTOCONFIRMED: return "move=autoconfirmed";
+    case Restrictions::EDIT_AUTOCONFIRMED_MOVE_SYSOP: return "edit=autoconfirmed:move=sysop";
+    case Restrictions::EDIT_AUTOCONFIRMED_MOVE_AUTOCONFIRMED: return "edit=autoconfirmed:move=autoconfirmed";
+    case Restrictions::SYSOP: return "sysop";
+    }
+    throw std::invalid_argument("Invalid restrictions");
+}
+
 namespace xml
 {
     template <> struct value_traits<Restrictions>
@@ -35,17 +51,7 @@ namespace xml
 
         static std::string serialize(Restrictions restrictions, const serializer&)
         {
-            switch (restrictions) {
-            case Restrictions::NONE: return "";
-            case Restrictions::EDIT_SYSOP_MOVE_SYSOP: return "edit=sysop:move=sysop";
-            case Restrictions::MOVE_SYSOP_EDIT_SYSOP: return "move=sysop:edit=sysop";
-            case Restrictions::MOVE_EDIT: return "move=:edit=";
-            case Restrictions::MOVE_SYSOP: return "move=sysop";
-            case Restrictions::MOVE_AUTOCONFIRMED: return "move=autoconfirmed";
-            case Restrictions::EDIT_AUTOCONFIRMED_MOVE_SYSOP: return "edit=autoconfirmed:move=sysop";
-            case Restrictions::EDIT_AUTOCONFIRMED_MOVE_AUTOCONFIRMED: return "edit=autoconfirmed:move=autoconfirmed";
-            case Restrictions::SYSOP: return "sysop";
-            }
+            return format_restrictions(restrictions);
         }
     };
 }
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <vector>
+
+// Bounded byte queue between a single producer thread and a single consumer thread
+class RingBuffer {
+public:
+    struct Cancelled {};
+
+    RingBuffer(size_t capacity) : data(capacity) {
+        start = 0;
+        size = 0;
+        closed = false;
+        cancelled = false;
+    }
+
+    // Blocks until everything is written; throws Cancelled if the consumer has gone away
+    void write(const char* buffer, size_t count) {
+        while (count > 0) {
+            std::unique_lock<std::mutex> lock(mutex);
+            not_full.wait(lock, [this] { return size < data.size() || cancelled; });
+
+            if (cancelled) {
+                throw Cancelled();
+            }
+
+            size_t end = (start + size) % data.size();
+            size_t chunk = std::min(count, std::min(data.size() - size, data.size() - end));
+            std::copy(buffer, buffer + chunk, data.begin() + end);
+            size += chunk;
+            buffer += chunk;
+            count -= chunk;
+
+            lock.unlock();
+            not_empty.notify_one();
+        }
+    }
+
+    // Blocks until some data is available; returns 0 once the producer has closed the buffer and it is drained
+    size_t read(char* buffer, size_t count) {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_empty.wait(lock, [this] { return size > 0 || closed; });
+
+        size_t chunk = std::min(count, std::min(size, data.size() - start));
+        std::copy(data.begin() + start, data.begin() + start + chunk, buffer);
+        start = (start + chunk) % data.size();
+        size -= chunk;
+
+        lock.unlock();
+        not_full.notify_one();
+
+        return chunk;
+    }
+
+    void close(std::exception_ptr error = nullptr) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+            this->error = error;
+        }
+        not_empty.notify_all();
+    }
+
+    void cancel() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            cancelled = true;
+        }
+        not_full.notify_all();
+    }
+
+    void rethrow_error() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+private:
+    std::vector<char> data;
+    size_t start;
+    size_t size;
+    bool closed;
+    bool cancelled;
+    std::exception_ptr error;
+
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+};
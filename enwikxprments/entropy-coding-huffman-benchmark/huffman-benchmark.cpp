@@ -0,0 +1,414 @@
+#include <Windows.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Times every builder of the Huffman libraries on rows of weights like the ones that the models predict: uniform ones
+// like np.random.rand, Zipfian ones like the tail of a softmax, tied ones like predictions rounded to a few levels, and
+// the recorded predictions of an LSTM. The libraries export the same names, so they are loaded from their DLLs next to
+// the benchmark, and the ones that are missing are skipped. Every builder has to give the code lengths of the first one
+// on every step, or the benchmark fails, as a stream that one of them codes is decoded by another. Writes a CSV line to
+// the standard output for every builder, distribution and category count:
+//   ns_per_tree: a load of the weights and the lengths of all the codes
+//   ns_per_code_length: a load of the weights and the length of the code of the step's category, as the notebooks use it
+//   bits_per_symbol: the expected length of a code under the weights, next to their entropy
+
+struct HuffmanTree;
+
+typedef HuffmanTree* (*CreateTree)(int category_count);
+typedef void (*DestroyTree)(HuffmanTree* tree);
+typedef void (*LoadWeights)(HuffmanTree* tree, float* weights);
+typedef void (*LoadWeightsWithStrategy)(HuffmanTree* tree, float* weights, int strategy);
+typedef int (*GetCodeLength)(HuffmanTree* tree, int category);
+typedef void (*GetCodeLengths)(HuffmanTree* tree, int* code_lengths);
+
+const char* const LIBRARY_NAMES[] = {
+    "entropy-coding-huffman-heap",
+    "entropy-coding-huffman-lazy",
+    "entropy-coding-huffman-two-queues",
+    "entropy-coding-huffman-two-queues-lazy",
+    "entropy-coding-huffman",
+};
+
+// The strategies of load_weights_with_strategy, in the order of their values
+const char* const STRATEGY_NAMES[] = {"heap", "heap-lazy", "two-queues", "two-queues-lazy"};
+
+const int ROUND_COUNT = 5;
+const double ZIPF_EXPONENT = 1.1;
+const int TIED_LEVEL_COUNT = 4;
+
+struct Builder {
+    std::string library_name;
+    std::string name;
+
+    CreateTree create_tree;
+    DestroyTree destroy_tree;
+    GetCodeLength get_code_length;
+    GetCodeLengths get_code_lengths;
+    std::function<void(HuffmanTree*, float*)> load_weights;
+};
+
+// The weights of step_count steps, a row of category_count for each, and the category that every step codes
+struct Distribution {
+    std::string name;
+    int category_count;
+    int step_count;
+    std::vector<float> weights;
+    std::vector<int> categories;
+    double entropy; // Per step, in bits
+
+    float* step_weights(int step) {
+        return weights.data() + (size_t) step * category_count;
+    }
+};
+
+struct Result {
+    double ns_per_tree;
+    double ns_per_code_length;
+    double bits_per_symbol;
+};
+
+template <typename Function>
+Function find_function(HMODULE module, const char* name) {
+    return (Function) GetProcAddress(module, name);
+}
+
+// A library with load_weights_with_strategy gets a builder for every strategy besides the one that it picks itself, and
+// one with load_weights_incrementally a builder that starts from the order of the previous step
+void add_builders(const std::string& library_name, std::vector<Builder>& builders) {
+    HMODULE module = LoadLibraryA((library_name + ".dll").c_str());
+    if (module == nullptr) {
+        std::cerr << "Skipping " << library_name << ", which could not be loaded" << std::endl;
+        return;
+    }
+
+    Builder builder;
+    builder.library_name = library_name;
+    builder.create_tree = find_function<CreateTree>(module, "create_tree");
+    builder.destroy_tree = find_function<DestroyTree>(module, "destroy_tree");
+    builder.get_code_length = find_function<GetCodeLength>(module, "get_code_length");
+    builder.get_code_lengths = find_function<GetCodeLengths>(module, "get_code_lengths");
+
+    LoadWeights load_weights = find_function<LoadWeights>(module, "load_weights");
+    LoadWeightsWithStrategy load_weights_with_strategy = find_function<LoadWeightsWithStrategy>(module, "load_weights_with_strategy");
+    LoadWeights load_weights_incrementally = find_function<LoadWeights>(module, "load_weights_incrementally");
+
+    if (builder.create_tree == nullptr || builder.destroy_tree == nullptr || builder.get_code_length == nullptr ||
+        builder.get_code_lengths == nullptr || load_weights == nullptr) {
+        std::cerr << "Skipping " << library_name << ", which lacks the functions of a Huffman library" << std::endl;
+        return;
+    }
+
+    builder.name = load_weights_with_strategy != nullptr ? "automatic" : "default";
+    builder.load_weights = load_weights;
+    builders.push_back(builder);
+
+    if (load_weights_with_strategy != nullptr) {
+        for (int strategy = 0; strategy < (int) (sizeof(STRATEGY_NAMES) / sizeof(STRATEGY_NAMES[0])); strategy++) {
+            builder.name = STRATEGY_NAMES[strategy];
+            builder.load_weights = [load_weights_with_strategy, strategy](HuffmanTree* tree, float* weights) {
+                load_weights_with_strategy(tree, weights, strategy);
+            };
+            builders.push_back(builder);
+        }
+    }
+
+    if (load_weights_incrementally != nullptr) {
+        builder.name = "incremental";
+        builder.load_weights = load_weights_incrementally;
+        builders.push_back(builder);
+    }
+}
+
+// Draws the categories from the weights of their steps, unless they were recorded, and finds the entropy
+void finish_distribution(Distribution& distribution, std::mt19937& generator) {
+    bool draws_categories = distribution.categories.empty();
+    distribution.categories.resize(distribution.step_count);
+    distribution.entropy = 0;
+
+    for (int step = 0; step < distribution.step_count; step++) {
+        const float* weights = distribution.step_weights(step);
+        double total_weight = 0;
+        for (int i = 0; i < distribution.category_count; i++) {
+            total_weight += weights[i];
+        }
+
+        for (int i = 0; i < distribution.category_count; i++) {
+            if (weights[i] > 0) {
+                double probability = weights[i] / total_weight;
+                distribution.entropy -= probability * log2(probability);
+            }
+        }
+
+        if (draws_categories) {
+            std::discrete_distribution<int> category(weights, weights + distribution.category_count);
+            distribution.categories[step] = category(generator);
+        }
+    }
+
+    distribution.entropy /= distribution.step_count;
+}
+
+Distribution create_uniform_distribution(int category_count, int step_count, std::mt19937& generator) {
+    Distribution distribution{"uniform", category_count, step_count};
+    distribution.weights.resize((size_t) step_count * category_count);
+
+    std::uniform_real_distribution<float> weight(0, 1);
+    for (float& value : distribution.weights) {
+        value = weight(generator);
+    }
+
+    finish_distribution(distribution, generator);
+    return distribution;
+}
+
+// Every step ranks the categories in another order
+Distribution create_zipf_distribution(int category_count, int step_count, std::mt19937& generator) {
+    Distribution distribution{"zipf", category_count, step_count};
+    distribution.weights.resize((size_t) step_count * category_count);
+
+    std::vector<int> ranks(category_count);
+    for (int i = 0; i < category_count; i++) {
+        ranks[i] = i;
+    }
+
+    for (int step = 0; step < step_count; step++) {
+        std::shuffle(ranks.begin(), ranks.end(), generator);
+        float* weights = distribution.step_weights(step);
+        for (int i = 0; i < category_count; i++) {
+            weights[i] = (float) pow(ranks[i] + 1, -ZIPF_EXPONENT);
+        }
+    }
+
+    finish_distribution(distribution, generator);
+    return distribution;
+}
+
+// Every weight is one of a few levels, so that most of them are tied with others
+Distribution create_tied_distribution(int category_count, int step_count, std::mt19937& generator) {
+    Distribution distribution{"tied", category_count, step_count};
+    distribution.weights.resize((size_t) step_count * category_count);
+
+    std::uniform_int_distribution<int> level(1, TIED_LEVEL_COUNT);
+    for (float& value : distribution.weights) {
+        value = (float) level(generator);
+    }
+
+    finish_distribution(distribution, generator);
+    return distribution;
+}
+
+// Reads up to max_step_count rows of category_count floats from a char-predictions file, and the 16-bit categories of a
+// char-actual file unless its path is empty
+Distribution read_recorded_distribution(const std::string& predictions_path, const std::string& actual_path, int category_count, int max_step_count, std::mt19937& generator) {
+    Distribution distribution{"recorded", category_count, 0};
+
+    FILE* predictions_file = fopen(predictions_path.c_str(), "rb");
+    if (predictions_file == nullptr) {
+        throw std::runtime_error("Could not open '" + predictions_path + "'");
+    }
+
+    std::vector<float> row(category_count);
+    while (distribution.step_count < max_step_count && fread(row.data(), sizeof(float), category_count, predictions_file) == (size_t) category_count) {
+        distribution.weights.insert(distribution.weights.end(), row.begin(), row.end());
+        distribution.step_count++;
+    }
+    fclose(predictions_file);
+
+    if (distribution.step_count == 0) {
+        throw std::runtime_error("'" + predictions_path + "' has no row of " + std::to_string(category_count) + " predictions");
+    }
+
+    if (!actual_path.empty()) {
+        FILE* actual_file = fopen(actual_path.c_str(), "rb");
+        if (actual_file == nullptr) {
+            throw std::runtime_error("Could not open '" + actual_path + "'");
+        }
+
+        std::vector<short> actual(distribution.step_count);
+        size_t actual_count = fread(actual.data(), sizeof(short), actual.size(), actual_file);
+        fclose(actual_file);
+
+        if (actual_count < actual.size()) {
+            throw std::runtime_error("'" + actual_path + "' has fewer categories than there are predictions");
+        }
+        distribution.categories.assign(actual.begin(), actual.end());
+    }
+
+    finish_distribution(distribution, generator);
+    return distribution;
+}
+
+// The best of a few rounds over all the steps, in nanoseconds per step
+template <typename Step>
+double time_steps(int step_count, Step step) {
+    double best_time = std::numeric_limits<double>::infinity();
+
+    for (int round = 0; round < ROUND_COUNT; round++) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < step_count; i++) {
+            step(i);
+        }
+        std::chrono::duration<double, std::nano> time = std::chrono::steady_clock::now() - start;
+        best_time = std::min(best_time, time.count());
+    }
+
+    return best_time / step_count;
+}
+
+// Loads the steps in order with every builder, as the incremental one only starts from the order of the previous step
+void check_code_lengths(const std::vector<Builder>& builders, Distribution& distribution) {
+    std::vector<HuffmanTree*> trees;
+    for (const Builder& builder : builders) {
+        trees.push_back(builder.create_tree(distribution.category_count));
+    }
+
+    std::vector<int> expected_lengths(distribution.category_count);
+    std::vector<int> code_lengths(distribution.category_count);
+    std::string mismatch;
+
+    for (int step = 0; step < distribution.step_count && mismatch.empty(); step++) {
+        for (size_t i = 0; i < builders.size() && mismatch.empty(); i++) {
+            builders[i].load_weights(trees[i], distribution.step_weights(step));
+            builders[i].get_code_lengths(trees[i], i == 0 ? expected_lengths.data() : code_lengths.data());
+
+            if (i > 0 && code_lengths != expected_lengths) {
+                mismatch = builders[i].library_name + " " + builders[i].name + " gives other code lengths than " +
+                    builders[0].library_name + " " + builders[0].name + " at step " + std::to_string(step) + " of " +
+                    distribution.name + " with " + std::to_string(distribution.category_count) + " categories";
+            }
+        }
+    }
+
+    for (size_t i = 0; i < builders.size(); i++) {
+        builders[i].destroy_tree(trees[i]);
+    }
+
+    if (!mismatch.empty()) {
+        throw std::runtime_error(mismatch);
+    }
+}
+
+Result measure(const Builder& builder, Distribution& distribution) {
+    HuffmanTree* tree = builder.create_tree(distribution.category_count);
+    std::vector<int> code_lengths(distribution.category_count);
+    Result result;
+
+    result.ns_per_tree = time_steps(distribution.step_count, [&](int step) {
+        builder.load_weights(tree, distribution.step_weights(step));
+        builder.get_code_lengths(tree, code_lengths.data());
+    });
+
+    result.ns_per_code_length = time_steps(distribution.step_count, [&](int step) {
+        builder.load_weights(tree, distribution.step_weights(step));
+        builder.get_code_length(tree, distribution.categories[step]);
+    });
+
+    // Checked apart from the timed rounds, so that the lengths are the ones of every builder
+    double expected_length = 0;
+    for (int step = 0; step < distribution.step_count; step++) {
+        float* weights = distribution.step_weights(step);
+        builder.load_weights(tree, weights);
+        builder.get_code_lengths(tree, code_lengths.data());
+
+        double total_weight = 0;
+        double weighted_length = 0;
+        for (int i = 0; i < distribution.category_count; i++) {
+            total_weight += weights[i];
+            weighted_length += (double) weights[i] * code_lengths[i];
+        }
+        expected_length += weighted_length / total_weight;
+    }
+    result.bits_per_symbol = expected_length / distribution.step_count;
+
+    builder.destroy_tree(tree);
+    return result;
+}
+
+int main(int argc, char** argv)
+try {
+    std::vector<int> category_counts;
+    int step_count = 256;
+    std::string predictions_path;
+    std::string actual_path;
+    int predictions_category_count = 0;
+
+    for (int arg_index = 1; arg_index < argc; ++arg_index) {
+        std::string arg = argv[arg_index];
+
+        if (arg == "--categories" && arg_index + 1 < argc) {
+            ++arg_index;
+            category_counts.push_back(atoi(argv[arg_index]));
+        }
+        else if (arg == "--steps" && arg_index + 1 < argc) {
+            ++arg_index;
+            step_count = atoi(argv[arg_index]);
+        }
+        else if (arg == "--predictions" && arg_index + 2 < argc) {
+            // The files have no header, so the number of categories of a row comes with them
+            predictions_path = argv[++arg_index];
+            predictions_category_count = atoi(argv[++arg_index]);
+        }
+        else if (arg == "--actual" && arg_index + 1 < argc) {
+            ++arg_index;
+            actual_path = argv[arg_index];
+        }
+        else {
+            std::cerr
+                << "Usage: " << argv[0] << " [--categories <count>]... [--steps <count>]"
+                << " [--predictions <char-predictions> <category count> [--actual <char-actual>]]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (category_counts.empty()) {
+        category_counts = {72, 256, 1024, 4096, 8192};
+    }
+    if (step_count <= 0 || *std::min_element(category_counts.begin(), category_counts.end()) < 2) {
+        throw std::runtime_error("The step count has to be positive and the category counts at least 2");
+    }
+
+    std::vector<Builder> builders;
+    for (const char* library_name : LIBRARY_NAMES) {
+        add_builders(library_name, builders);
+    }
+
+    std::mt19937 generator(0);
+    std::vector<Distribution> distributions;
+    for (int category_count : category_counts) {
+        distributions.push_back(create_uniform_distribution(category_count, step_count, generator));
+        distributions.push_back(create_zipf_distribution(category_count, step_count, generator));
+        distributions.push_back(create_tied_distribution(category_count, step_count, generator));
+    }
+    if (!predictions_path.empty()) {
+        distributions.push_back(read_recorded_distribution(predictions_path, actual_path, predictions_category_count, step_count, generator));
+    }
+
+    printf("library,builder,distribution,category_count,step_count,ns_per_tree,ns_per_code_length,bits_per_symbol,entropy\n");
+    for (Distribution& distribution : distributions) {
+        check_code_lengths(builders, distribution);
+
+        for (const Builder& builder : builders) {
+            Result result = measure(builder, distribution);
+
+            printf("%s,%s,%s,%d,%d,%.1f,%.1f,%.5f,%.5f\n",
+                builder.library_name.c_str(), builder.name.c_str(), distribution.name.c_str(), distribution.category_count,
+                distribution.step_count, result.ns_per_tree, result.ns_per_code_length, result.bits_per_symbol, distribution.entropy);
+            fflush(stdout);
+        }
+    }
+}
+catch (std::exception& error) {
+    std::cerr << "An error occurred: " << error.what() << std::endl;
+    return 2;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+
+// Reads what BitWriter writes, most significant bit first. The next bits are kept at the top of a 64-bit buffer, which
+// is refilled eight bytes at a time without any branches on the bit count. Past the end of the data it reads zeros.
+class BitReader {
+public:
+    BitReader(const unsigned char* data, size_t size) : current(data), end(data + size), buffer(0), buffer_length(0) {
+        refill();
+    }
+
+    // Makes at least 56 bits available to peek at
+    void refill() {
+        if (end - current >= 8) {
+            buffer |= load_big_endian(current) >> buffer_length;
+            current += (63 - buffer_length) >> 3;
+            buffer_length |= 56;
+        }
+        else {
+            while (buffer_length <= 56) {
+                unsigned long long byte = current < end ? *current++ : 0;
+                buffer |= byte << (56 - buffer_length);
+                buffer_length += 8;
+            }
+        }
+    }
+
+    // The length has to be between 1 and the number of bits that were made available
+    unsigned long long peek(int length) const {
+        return buffer >> (64 - length);
+    }
+
+    void skip(int length) {
+        buffer <<= length;
+        buffer_length -= length;
+    }
+
+private:
+    const unsigned char* current;
+    const unsigned char* end;
+    unsigned long long buffer; // The bits below the top buffer_length are the ones that follow, or zeros
+    int buffer_length;
+
+    static unsigned long long load_big_endian(const unsigned char* data) {
+        unsigned long long result;
+        memcpy(&result, data, sizeof(result));
+#ifdef _MSC_VER
+        return _byteswap_uint64(result);
+#else
+        return __builtin_bswap64(result);
+#endif
+    }
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+
+// Packs codes into bytes, most significant bit first. The codes go into a 64-bit buffer, which is emptied 32 bits at a
+// time, so most writes are a shift and an OR.
+class BitWriter {
+public:
+    BitWriter() : buffer(0), buffer_length(0), bit_count(0) {}
+
+    // The code must not have bits set above its length, which is at most 64
+    void write(unsigned long long code, int length) {
+        if (length > 32) {
+            write_bits(code >> 32, length - 32);
+            write_bits(code & 0xFFFFFFFF, 32);
+        }
+        else {
+            write_bits(code, length);
+        }
+    }
+
+    // Writes out what is left in the buffer, padding the last byte with zeros
+    void finish() {
+        while (buffer_length >= 8) {
+            buffer_length -= 8;
+            bytes.push_back((unsigned char) (buffer >> buffer_length));
+        }
+
+        if (buffer_length > 0) {
+            bytes.push_back((unsigned char) (buffer << (8 - buffer_length)));
+            buffer_length = 0;
+        }
+    }
+
+    void clear() {
+        bytes.clear();
+        buffer = 0;
+        buffer_length = 0;
+        bit_count = 0;
+    }
+
+    const std::vector<unsigned char>& data() const {
+        return bytes;
+    }
+
+    unsigned long long size_in_bits() const {
+        return bit_count;
+    }
+
+private:
+    std::vector<unsigned char> bytes;
+    unsigned long long buffer; // Only the last buffer_length bits are still to be written
+    int buffer_length;
+    unsigned long long bit_count;
+
+    void write_bits(unsigned long long bits, int length) {
+        buffer = buffer << length | bits;
+        buffer_length += length;
+        bit_count += length;
+
+        if (buffer_length >= 32) {
+            buffer_length -= 32;
+            unsigned int word = (unsigned int) (buffer >> buffer_length);
+            bytes.push_back((unsigned char) (word >> 24));
+            bytes.push_back((unsigned char) (word >> 16));
+            bytes.push_back((unsigned char) (word >> 8));
+            bytes.push_back((unsigned char) word);
+        }
+    }
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <algorithm>
+
+// The longest code that fits into the integers that the codes are stored in
+const int MAX_CODE_LENGTH = 64;
+
+// Canonical codes depend only on the code lengths: the codes of each length are consecutive integers in the order of
+// the categories, and every length starts right after the codes of the shorter ones, shifted by a bit. The tree itself
+// is not needed to encode, and a decoder needs nothing but the lengths.
+class CanonicalCode {
+public:
+    // The categories are counted in this many consecutive parts at once. Neighbouring categories often have the same
+    // length, and an increment of a count would otherwise have to wait for the previous one.
+    static const int PARTS = 4;
+
+    // Returns false if a code is longer than MAX_CODE_LENGTH bits
+    bool load_code_lengths(const int* code_lengths, int category_count) {
+        int part_counts[PARTS][MAX_CODE_LENGTH + 1];
+        int length_counts[MAX_CODE_LENGTH + 1];
+        if (!count_code_lengths(code_lengths, category_count, part_counts, length_counts)) {
+            return false;
+        }
+
+        load_length_counts(length_counts);
+        return true;
+    }
+
+    void load_length_counts(const int* length_counts) {
+        unsigned long long code = 0;
+        first_codes[0] = 0;
+
+        for (int length = 1; length <= MAX_CODE_LENGTH; length++) {
+            code = (code + (length > 1 ? length_counts[length - 1] : 0)) << 1;
+            first_codes[length] = code;
+        }
+    }
+
+    // Fills the number of codes of every length, in total and in every part of the categories. Returns false if a code
+    // is longer than MAX_CODE_LENGTH bits.
+    static bool count_code_lengths(const int* code_lengths, int category_count, int part_counts[][MAX_CODE_LENGTH + 1], int* length_counts) {
+        std::fill(part_counts[0], part_counts[0] + PARTS * (MAX_CODE_LENGTH + 1), 0);
+        int part_size = (category_count + PARTS - 1) / PARTS;
+
+        for (int i = 0; i < part_size; i++) {
+            for (int part = 0; part < PARTS; part++) {
+                int category = part * part_size + i;
+                if (category < category_count) {
+                    if (code_lengths[category] > MAX_CODE_LENGTH) {
+                        return false;
+                    }
+                    ++part_counts[part][code_lengths[category]];
+                }
+            }
+        }
+
+        for (int length = 0; length <= MAX_CODE_LENGTH; length++) {
+            length_counts[length] = 0;
+            for (int part = 0; part < PARTS; part++) {
+                length_counts[length] += part_counts[part][length];
+            }
+        }
+
+        return true;
+    }
+
+    // Fills the codes of all categories from the same lengths that were loaded
+    void assign_codes(const int* code_lengths, int category_count, unsigned long long* codes) const {
+        unsigned long long next_codes[MAX_CODE_LENGTH + 1];
+        std::copy(first_codes, first_codes + MAX_CODE_LENGTH + 1, next_codes);
+
+        for (int i = 0; i < category_count; i++) {
+            codes[i] = next_codes[code_lengths[i]]++;
+        }
+    }
+
+    // The code of a single category: the first code of its length plus the categories before it with the same length
+    unsigned long long code(const int* code_lengths, int category) const {
+        unsigned long long result = first_codes[code_lengths[category]];
+
+        for (int i = 0; i < category; i++) {
+            result += code_lengths[i] == code_lengths[category];
+        }
+
+        return result;
+    }
+
+    unsigned long long first_code(int length) const {
+        return first_codes[length];
+    }
+
+private:
+    unsigned long long first_codes[MAX_CODE_LENGTH + 1];
+};
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <float.h>
+#include <algorithm>
+#include <queue>
+#include <vector>
+
+#include "huffman_tree.hpp"
+
+// The ways of building a tree that the libraries are made of. The full builders take the leaves in
+// sorted_leaves[0, leaf_count) and hang them under the root, so that the lazy libraries can pass only the leaves that
+// separate_dominant_leaves left without parents.
+//
+// Every builder takes the nodes in the same order: by their weights, and the ones of the same weight by their indices,
+// which puts the leaves before the internal nodes and the internal nodes in the order they were made. So the codes
+// depend on the weights alone, and not on the builder, which the unified library picks by the speed of the machine.
+
+// The node that a heap should give out last, the heavier one or, of the same weight, the one with the higher index
+struct HeavierNode
+{
+    const float* weights;
+
+    bool operator()(int lhs, int rhs) const
+    {
+        return weights[lhs] < weights[rhs] || (weights[lhs] == weights[rhs] && lhs < rhs);
+    }
+};
+
+struct LighterNode
+{
+    const float* weights;
+
+    bool operator()(int lhs, int rhs) const
+    {
+        return weights[lhs] > weights[rhs] || (weights[lhs] == weights[rhs] && lhs > rhs);
+    }
+};
+
+// Puts all the categories in sorted_leaves, for a full build, and returns their number
+inline int collect_all_leaves(HuffmanTree* tree) {
+    int* leaves = tree->sorted_leaves.data();
+
+    for (int i = 0; i < tree->category_count; i++) {
+        leaves[i] = i;
+    }
+    return tree->category_count;
+}
+
+// Puts the categories that a lazy load left without parents in sorted_leaves, and returns their number
+inline int collect_unparented_leaves(HuffmanTree* tree) {
+    int* leaves = tree->sorted_leaves.data();
+    int leaf_count = 0;
+
+    for (int i = 0; i < tree->category_count; i++) {
+        if (tree->parent_indices[i] == -1) {
+            leaves[leaf_count++] = i;
+        }
+    }
+    return leaf_count;
+}
+
+// Takes the two lightest nodes of a heap until two are left
+inline void build_with_heap(HuffmanTree* tree, int leaf_count) {
+    std::vector<int> nodes(tree->sorted_leaves.begin(), tree->sorted_leaves.begin() + leaf_count);
+    std::priority_queue<int, std::vector<int>, LighterNode> heap(LighterNode{tree->weights.data()}, std::move(nodes));
+
+    int new_parent_index = tree->category_count;
+
+    while (heap.size() > 2) {
+        int left = heap.top();
+        heap.pop();
+        tree->parent_indices[left] = new_parent_index;
+        tree->labels[left] = Label::ZERO;
+
+        int right = heap.top();
+        heap.pop();
+        tree->parent_indices[right] = new_parent_index;
+        tree->labels[right] = Label::ONE;
+
+        tree->weights[new_parent_index] = tree->weights[left] + tree->weights[right];
+
+        heap.push(new_parent_index);
+        ++new_parent_index;
+    }
+
+    tree->internal_node_end = new_parent_index;
+
+    tree->parent_indices[heap.top()] = tree->root_node_index;
+    tree->labels[heap.top()] = Label::ZERO;
+    heap.pop();
+    tree->parent_indices[heap.top()] = tree->root_node_index;
+    tree->labels[heap.top()] = Label::ONE;
+}
+
+// Merges the leaves, which have to be sorted by their weights and then by their indices already. The internal nodes are
+// made in the order of their weights, so they need no queue of their own: the ones that are not merged yet are those
+// from next_node to the new parent. The lighter of the two fronts is taken next, the leaf if they weigh the same.
+inline void merge_sorted_leaves(HuffmanTree* tree, int leaf_count) {
+    const int* leaves = tree->sorted_leaves.data();
+    float* weights = tree->weights.data();
+    int* parent_indices = tree->parent_indices.data();
+    Label* labels = tree->labels.data();
+
+    int next_leaf = 0;
+    int next_node = tree->category_count;
+    int new_parent_index = tree->category_count;
+    int internal_node_end = tree->category_count + leaf_count - 2;
+
+    auto take_lightest = [&]() {
+        if (next_leaf < leaf_count && (next_node == new_parent_index || weights[leaves[next_leaf]] <= weights[next_node])) {
+            return leaves[next_leaf++];
+        }
+        return next_node++;
+    };
+
+    for (; new_parent_index < internal_node_end; new_parent_index++) {
+        int left = take_lightest();
+        parent_indices[left] = new_parent_index;
+        labels[left] = Label::ZERO;
+
+        int right = take_lightest();
+        parent_indices[right] = new_parent_index;
+        labels[right] = Label::ONE;
+
+        weights[new_parent_index] = weights[left] + weights[right];
+    }
+
+    tree->internal_node_end = internal_node_end;
+
+    int left = take_lightest();
+    parent_indices[left] = tree->root_node_index;
+    labels[left] = Label::ZERO;
+
+    int right = take_lightest();
+    parent_indices[right] = tree->root_node_index;
+    labels[right] = Label::ONE;
+}
+
+// Sorts the leaves with a radix sort and merges them
+inline void build_with_queues(HuffmanTree* tree, int leaf_count) {
+    int* leaves = tree->sorted_leaves.data();
+
+    tree->sorter.sort(tree->weights.data(), leaves, leaf_count, leaves);
+    merge_sorted_leaves(tree, leaf_count);
+}
+
+// Gives the categories that take more than half of the remaining weight their own nodes on a chain of roots, the
+// heaviest first, and leaves the rest of them without parents until a code needs them. The weights have to be in the
+// tree already.
+//
+// A full build would give such a category the same place: every other node weighs less, so it is merged last. The
+// full build adds the weights up in floats, though, which can round the rest up to the weight of the category, so a
+// category is only separated while it outweighs the rest by more than that rounding.
+inline void separate_dominant_leaves(HuffmanTree* tree) {
+    int* leaves = tree->sorted_leaves.data();
+    double total_weight = 0;
+    double rounding = tree->category_count * (double) FLT_EPSILON;
+
+    tree->root_node_index = 2 * tree->category_count - 2;
+    tree->internal_node_end = 0; // Until the full tree is built
+
+    for (int i = 0; i < tree->category_count; i++) {
+        total_weight += tree->weights[i];
+        tree->parent_indices[i] = -1;
+        tree->labels[i] = Label::ONE;
+        leaves[i] = i;
+    }
+
+    HeavierNode heavier_node{tree->weights.data()};
+    int heap_size = tree->category_count;
+    std::make_heap(leaves, leaves + heap_size, heavier_node);
+
+    for (int node = leaves[0]; heap_size > 2; std::pop_heap(leaves, leaves + heap_size--, heavier_node), node = leaves[0]) {
+        if (tree->weights[node] <= (total_weight - tree->weights[node]) * (1 + rounding)) {
+            break;
+        }
+        tree->parent_indices[node] = tree->root_node_index;
+
+        int new_root_index = tree->root_node_index - 1;
+        tree->parent_indices[new_root_index] = tree->root_node_index;
+        tree->labels[new_root_index] = Label::ZERO;
+        tree->root_node_index = new_root_index;
+        total_weight -= tree->weights[node];
+    }
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <assert.h>
+#include <vector>
+
+#include "bit_reader.hpp"
+#include "canonical_code.hpp"
+
+// Decodes canonical codes with a table indexed by the next TABLE_BITS bits of the stream. An entry holds every code
+// that fits into its bits, up to MAX_CATEGORIES_PER_ENTRY, so that short codes come out several at a time; the few
+// longer codes are found by comparing with the first code of every length. Loading the lengths costs O(V) and a fill
+// of the table, which is little enough to do for a code that changes with every category.
+class HuffmanDecoder {
+public:
+    static const int TABLE_BITS = 12;
+    static const int MAX_CATEGORIES_PER_ENTRY = 3;
+    static const int LONG_CODE_BITS = 56;
+
+    // Returns false if a code is longer than MAX_CODE_LENGTH bits. Filling the entries with more than one category
+    // costs another pass over the table, which only pays off when more than a few categories are decoded with the code.
+    bool load_code_lengths(const int* code_lengths, int category_count, bool multiple_categories_per_entry) {
+        assert(category_count <= 1 << 16);
+
+        const int PARTS = CanonicalCode::PARTS;
+        int part_counts[PARTS][MAX_CODE_LENGTH + 1];
+        if (!CanonicalCode::count_code_lengths(code_lengths, category_count, part_counts, length_counts)) {
+            return false;
+        }
+
+        CanonicalCode canonical_code;
+        canonical_code.load_length_counts(length_counts);
+
+        lengths.assign(code_lengths, code_lengths + category_count);
+        sorted_categories.resize(category_count);
+
+        // Every part of the categories gets its own place among the ones of the same length, so the parts are sorted at
+        // once for the same reason that they are counted at once
+        int next_indices[PARTS][MAX_CODE_LENGTH + 1];
+        max_length = 0;
+        for (int length = 1, index = 0; length <= MAX_CODE_LENGTH; length++) {
+            first_codes[length] = canonical_code.first_code(length);
+            first_indices[length] = index;
+            for (int part = 0; part < PARTS; part++) {
+                next_indices[part][length] = index;
+                index += part_counts[part][length];
+            }
+            max_length = length_counts[length] > 0 ? length : max_length;
+        }
+
+        int part_size = (category_count + PARTS - 1) / PARTS;
+        for (int i = 0; i < part_size; i++) {
+            for (int part = 0; part < PARTS; part++) {
+                int category = part * part_size + i;
+                if (category < category_count) {
+                    sorted_categories[next_indices[part][code_lengths[category]]++] = (unsigned short) category;
+                }
+            }
+        }
+
+        fill_table();
+        if (multiple_categories_per_entry) {
+            append_following_categories();
+        }
+
+        return true;
+    }
+
+    // Returns -1 if the stream has no valid code at this point
+    int decode(BitReader& reader) const {
+        reader.refill();
+        const TableEntry& entry = table[reader.peek(TABLE_BITS)];
+        if (entry.category_count == 0) {
+            return decode_long(reader);
+        }
+
+        reader.skip(lengths[entry.categories[0]]);
+        return entry.categories[0];
+    }
+
+    void decode(BitReader& reader, int* categories, size_t count) const {
+        size_t i = 0;
+
+        while (i + MAX_CATEGORIES_PER_ENTRY <= count) {
+            reader.refill();
+            const TableEntry& entry = table[reader.peek(TABLE_BITS)];
+            if (entry.category_count == 0) {
+                categories[i++] = decode_long(reader);
+                continue;
+            }
+
+            // All the categories are copied, and the ones that are not in the entry are overwritten by the next ones
+            for (int j = 0; j < MAX_CATEGORIES_PER_ENTRY; j++) {
+                categories[i + j] = entry.categories[j];
+            }
+            reader.skip(entry.bit_count);
+            i += entry.category_count;
+        }
+
+        for (; i < count; i++) {
+            categories[i] = decode(reader);
+        }
+    }
+
+private:
+    struct TableEntry {
+        unsigned short categories[MAX_CATEGORIES_PER_ENTRY];
+        unsigned char bit_count; // The length of all the codes in the entry together
+        unsigned char category_count; // 0 if the code is longer than TABLE_BITS
+    };
+
+    TableEntry table[1 << TABLE_BITS];
+    std::vector<int> lengths;
+    std::vector<unsigned short> sorted_categories; // In the order of their codes
+    unsigned long long first_codes[MAX_CODE_LENGTH + 1];
+    int first_indices[MAX_CODE_LENGTH + 1]; // The position in sorted_categories of the first code of every length
+    int length_counts[MAX_CODE_LENGTH + 1];
+    int max_length;
+
+    // The canonical codes that are not longer than the table index cover a range at the start of the table, in order
+    void fill_table() {
+        int position = 0;
+
+        for (int length = 1; length <= TABLE_BITS && length <= max_length; length++) {
+            int entry_count = 1 << (TABLE_BITS - length);
+
+            for (int i = 0; i < length_counts[length]; i++) {
+                TableEntry entry = {{sorted_categories[first_indices[length] + i], 0, 0}, (unsigned char) length, 1};
+                std::fill(table + position, table + position + entry_count, entry);
+                position += entry_count;
+            }
+        }
+
+        TableEntry long_code = {{0, 0, 0}, 0, 0};
+        std::fill(table + position, table + (1 << TABLE_BITS), long_code);
+    }
+
+    // The bits of an entry after its codes, shifted to the top, index the entry of the code that follows. That entry may
+    // have been extended already, but its first category stays the same.
+    void append_following_categories() {
+        const int mask = (1 << TABLE_BITS) - 1;
+
+        for (int i = 0; i < 1 << TABLE_BITS; i++) {
+            TableEntry& entry = table[i];
+
+            while (entry.category_count > 0 && entry.category_count < MAX_CATEGORIES_PER_ENTRY) {
+                const TableEntry& next = table[(i << entry.bit_count) & mask];
+                if (next.category_count == 0 || entry.bit_count + lengths[next.categories[0]] > TABLE_BITS) {
+                    break;
+                }
+
+                entry.categories[entry.category_count++] = next.categories[0];
+                entry.bit_count += (unsigned char) lengths[next.categories[0]];
+            }
+        }
+    }
+
+    // The longer codes start with a prefix that is past all the codes of every shorter length, so the code is at the
+    // first length where the next bits fall among its codes. Codes longer than a refill guarantees go a bit at a time.
+    int decode_long(BitReader& reader) const {
+        if (max_length <= LONG_CODE_BITS) {
+            unsigned long long bits = reader.peek(LONG_CODE_BITS);
+
+            for (int length = TABLE_BITS + 1; length <= max_length; length++) {
+                unsigned long long offset = (bits >> (LONG_CODE_BITS - length)) - first_codes[length];
+                if (offset < (unsigned long long) length_counts[length]) {
+                    reader.skip(length);
+                    return sorted_categories[first_indices[length] + (int) offset];
+                }
+            }
+
+            return -1;
+        }
+
+        unsigned long long code = reader.peek(TABLE_BITS);
+        reader.skip(TABLE_BITS);
+
+        for (int length = TABLE_BITS + 1; length <= max_length; length++) {
+            reader.refill();
+            code = code << 1 | reader.peek(1);
+            reader.skip(1);
+
+            unsigned long long offset = code - first_codes[length];
+            if (offset < (unsigned long long) length_counts[length]) {
+                return sorted_categories[first_indices[length] + (int) offset];
+            }
+        }
+
+        return -1;
+    }
+};
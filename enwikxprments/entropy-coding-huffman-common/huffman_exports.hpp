@@ -0,0 +1,317 @@
+#pragma once
+
+#include <assert.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "bit_reader.hpp"
+#include "bit_writer.hpp"
+#include "canonical_code.hpp"
+#include "huffman_decoder.hpp"
+#include "huffman_tree.hpp"
+#include "thread_pool.hpp"
+
+// The exports that all the Huffman libraries share, around the builder of each. A library defines, before it includes
+// this:
+//   ExportedTree, the HuffmanTree that its exports take
+//   load_typed_weights(ExportedTree*, const Weight*), which loads the weights of any of the types that convert_weights
+//     takes and builds the tree, or only its chain of roots if the library is lazy
+//   initialize_full_tree(ExportedTree*), which builds the nodes that a lazy load left without parents
+//   load_batch_step(ExportedTree*, float*), which loads the weights of a step of encode_batch after the ones of the step
+//     before it
+// The exports need C names for ctypes, so the hooks are found by name rather than passed as template arguments.
+
+// A tree for every thread of the pool, so that the steps of a batch can be coded at once
+struct BatchEncoder {
+    BatchEncoder(unsigned thread_count) : pool(thread_count) {}
+
+    ThreadPool pool;
+    std::vector<ExportedTree*> trees;
+    std::vector<unsigned long long> codes; // The code of every step of the batch
+};
+
+const size_t BATCH_CHUNK_SIZE = 16;
+
+// A lazy load leaves internal_node_end under category_count until the full tree is built, and every full build leaves it
+// at category_count or above, so the checks only build anything for the lazy libraries
+void ensure_category_initialization(ExportedTree* tree, int category) {
+    if (tree->parent_indices[category] == -1) {
+        initialize_full_tree(tree);
+    }
+}
+
+void ensure_full_initialization(ExportedTree* tree) {
+    if (tree->internal_node_end < tree->category_count) {
+        initialize_full_tree(tree);
+    }
+}
+
+extern "C" {
+
+__declspec(dllexport) ExportedTree* create_tree(int category_count) {
+    assert(category_count > 1);
+
+    return new ExportedTree(category_count);
+}
+
+__declspec(dllexport) void destroy_tree(ExportedTree* tree) {
+    delete tree;
+}
+
+__declspec(dllexport) void load_weights(ExportedTree* tree, float* weights) {
+    load_typed_weights(tree, weights);
+}
+
+__declspec(dllexport) void load_double_weights(ExportedTree* tree, double* weights) {
+    load_typed_weights(tree, weights);
+}
+
+__declspec(dllexport) void load_bfloat16_weights(ExportedTree* tree, BFloat16* weights) {
+    load_typed_weights(tree, weights);
+}
+
+// The weights are fixed-point numbers of any scale
+__declspec(dllexport) void load_fixed_point_weights(ExportedTree* tree, int* weights) {
+    load_typed_weights(tree, weights);
+}
+
+__declspec(dllexport) int get_code_length(ExportedTree* tree, int category) {
+    int depth = 0;
+
+    ensure_category_initialization(tree, category);
+
+    for (int node_index = category; node_index != 2 * tree->category_count - 2; node_index = tree->parent_indices[node_index]) {
+        ++depth;
+    }
+
+    return depth;
+}
+
+__declspec(dllexport) int get_code_zero_count(ExportedTree* tree, int category) {
+    int depth = 0;
+
+    ensure_category_initialization(tree, category);
+
+    for (int node_index = category; node_index != 2 * tree->category_count - 2; node_index = tree->parent_indices[node_index]) {
+        depth += (tree->labels[node_index] == Label::ZERO);
+    }
+
+    return depth;
+}
+
+__declspec(dllexport) char* create_code_string(ExportedTree* tree, int category) {
+    char* code = new char[tree->category_count];
+    int position = 0;
+
+    ensure_category_initialization(tree, category);
+
+    for (int node_index = category; node_index != 2 * tree->category_count - 2; node_index = tree->parent_indices[node_index]) {
+        code[position++] = tree->labels[node_index] == Label::ONE ? '1' : '0';
+    }
+    code[position] = '\0';
+
+    std::reverse(code, code + position);
+    return code;
+}
+
+// Frees a string of create_code_string. With ctypes, create_code_string needs a restype of c_void_p rather than
+// c_char_p, which would copy the string and drop the pointer to it.
+__declspec(dllexport) void destroy_code_string(char* string) {
+    delete[] string;
+}
+
+__declspec(dllexport) void get_code_lengths(ExportedTree* tree, int* code_lengths) {
+    ensure_full_initialization(tree);
+    tree->compute_code_lengths(code_lengths);
+}
+
+// Loads the weights into a tree with no code longer than max_code_length bits, with the lengths of an optimal code under
+// that limit. Returns how many bits the limit adds to the expected code length of the unlimited tree, or -1 if the
+// categories do not fit into codes of that length, in which case the tree is left unlimited.
+__declspec(dllexport) float load_weights_with_length_limit(ExportedTree* tree, float* weights, int max_code_length) {
+    load_weights(tree, weights);
+
+    std::vector<int> code_lengths(tree->category_count);
+    get_code_lengths(tree, code_lengths.data());
+    if (*std::max_element(code_lengths.begin(), code_lengths.end()) <= max_code_length) {
+        return 0;
+    }
+
+    double total_weight = 0;
+    double unlimited_length = 0;
+    for (int i = 0; i < tree->category_count; i++) {
+        total_weight += weights[i];
+        unlimited_length += (double) weights[i] * code_lengths[i];
+    }
+
+    if (!tree->limit_code_lengths(max_code_length, code_lengths.data())) {
+        return -1;
+    }
+    tree->load_code_lengths(code_lengths.data());
+
+    double limited_length = 0;
+    for (int i = 0; i < tree->category_count; i++) {
+        limited_length += (double) weights[i] * code_lengths[i];
+    }
+
+    return total_weight > 0 ? (float) ((limited_length - unlimited_length) / total_weight) : 0;
+}
+
+// Fills the lengths and the canonical codes of all categories. Returns the length of the longest code, or -1 if it is
+// longer than MAX_CODE_LENGTH bits.
+__declspec(dllexport) int get_canonical_codes(ExportedTree* tree, int* code_lengths, unsigned long long* codes) {
+    get_code_lengths(tree, code_lengths);
+
+    CanonicalCode canonical_code;
+    if (!canonical_code.load_code_lengths(code_lengths, tree->category_count)) {
+        return -1;
+    }
+    canonical_code.assign_codes(code_lengths, tree->category_count, codes);
+
+    return *std::max_element(code_lengths, code_lengths + tree->category_count);
+}
+
+__declspec(dllexport) BitWriter* create_bit_writer() {
+    return new BitWriter();
+}
+
+__declspec(dllexport) void destroy_bit_writer(BitWriter* writer) {
+    delete writer;
+}
+
+__declspec(dllexport) void write_code(BitWriter* writer, unsigned long long code, int length) {
+    writer->write(code, length);
+}
+
+// Appends the canonical code of the category under the loaded weights. Returns its length, or -1 if a code of the tree
+// is longer than MAX_CODE_LENGTH bits, in which case nothing is written.
+__declspec(dllexport) int encode_category(ExportedTree* tree, BitWriter* writer, int category) {
+    std::vector<int> code_lengths(tree->category_count);
+    get_code_lengths(tree, code_lengths.data());
+
+    CanonicalCode canonical_code;
+    if (!canonical_code.load_code_lengths(code_lengths.data(), tree->category_count)) {
+        return -1;
+    }
+    writer->write(canonical_code.code(code_lengths.data(), category), code_lengths[category]);
+
+    return code_lengths[category];
+}
+
+// Pads the last byte with zeros and returns the size of the written data in bytes
+__declspec(dllexport) size_t finish_bit_writer(BitWriter* writer) {
+    writer->finish();
+    return writer->data().size();
+}
+
+__declspec(dllexport) const unsigned char* get_bit_writer_data(BitWriter* writer) {
+    return writer->data().data();
+}
+
+__declspec(dllexport) BitReader* create_bit_reader(const unsigned char* data, size_t size) {
+    return new BitReader(data, size);
+}
+
+__declspec(dllexport) void destroy_bit_reader(BitReader* reader) {
+    delete reader;
+}
+
+__declspec(dllexport) HuffmanDecoder* create_decoder() {
+    return new HuffmanDecoder();
+}
+
+__declspec(dllexport) void destroy_decoder(HuffmanDecoder* decoder) {
+    delete decoder;
+}
+
+// Prepares the decoder for many categories coded with the loaded weights, as decode_categories reads them. Returns -1
+// if a code of the tree is longer than MAX_CODE_LENGTH bits.
+__declspec(dllexport) int load_decoder(ExportedTree* tree, HuffmanDecoder* decoder) {
+    std::vector<int> code_lengths(tree->category_count);
+    get_code_lengths(tree, code_lengths.data());
+
+    return decoder->load_code_lengths(code_lengths.data(), tree->category_count, true) ? 0 : -1;
+}
+
+__declspec(dllexport) void decode_categories(HuffmanDecoder* decoder, BitReader* reader, int* categories, size_t count) {
+    decoder->decode(*reader, categories, count);
+}
+
+// Reads the category that encode_category wrote under the loaded weights. Returns -1 if a code of the tree is longer
+// than MAX_CODE_LENGTH bits or the data has no valid code at this point.
+__declspec(dllexport) int decode_category(ExportedTree* tree, HuffmanDecoder* decoder, BitReader* reader) {
+    std::vector<int> code_lengths(tree->category_count);
+    get_code_lengths(tree, code_lengths.data());
+
+    if (!decoder->load_code_lengths(code_lengths.data(), tree->category_count, false)) {
+        return -1;
+    }
+
+    return decoder->decode(*reader);
+}
+
+// A thread count of 0 takes all the cores
+__declspec(dllexport) BatchEncoder* create_batch_encoder(int category_count, int thread_count) {
+    unsigned count = thread_count > 0 ? thread_count : std::max(std::thread::hardware_concurrency(), 1u);
+    BatchEncoder* encoder = new BatchEncoder(count);
+
+    for (unsigned i = 0; i < count; i++) {
+        encoder->trees.push_back(create_tree(category_count));
+    }
+
+    return encoder;
+}
+
+__declspec(dllexport) void destroy_batch_encoder(BatchEncoder* encoder) {
+    for (ExportedTree* tree : encoder->trees) {
+        destroy_tree(tree);
+    }
+
+    delete encoder;
+}
+
+// Builds the tree of every step from its row of the [step_count, category_count] weights, and fills the code length of
+// the step's category. The codes are appended to the writer, unless it is null. Returns -1 if a code of a tree is longer
+// than MAX_CODE_LENGTH bits, in which case only the lengths are filled.
+__declspec(dllexport) int encode_batch(BatchEncoder* encoder, float* weights, const int* categories, int step_count, int* code_lengths, BitWriter* writer) {
+    int category_count = encoder->trees[0]->category_count;
+    std::atomic<bool> too_long(false);
+    encoder->codes.resize(step_count);
+
+    encoder->pool.run(step_count, BATCH_CHUNK_SIZE, [&](unsigned thread_index, size_t begin, size_t end) {
+        ExportedTree* tree = encoder->trees[thread_index];
+        std::vector<int> lengths(category_count);
+        CanonicalCode canonical_code;
+
+        for (size_t step = begin; step < end; step++) {
+            load_batch_step(tree, weights + step * category_count);
+            get_code_lengths(tree, lengths.data());
+            code_lengths[step] = lengths[categories[step]];
+
+            if (writer != nullptr) {
+                if (canonical_code.load_code_lengths(lengths.data(), category_count)) {
+                    encoder->codes[step] = canonical_code.code(lengths.data(), categories[step]);
+                }
+                else {
+                    too_long = true;
+                }
+            }
+        }
+    });
+
+    if (too_long) {
+        return -1;
+    }
+
+    if (writer != nullptr) {
+        for (int step = 0; step < step_count; step++) {
+            writer->write(encoder->codes[step], code_lengths[step]);
+        }
+    }
+
+    return 0;
+}
+
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <assert.h>
+#include <algorithm>
+#include <vector>
+
+#include "length_limiter.hpp"
+#include "weight_conversion.hpp"
+#include "weight_sorter.hpp"
+
+enum class Label : unsigned char {
+    ZERO,
+    ONE
+};
+
+// The nodes are kept in separate arrays, so that the passes that need only the weights or only the parents do not load
+// the rest. The leaves are the first category_count nodes and the root is 2 * category_count - 2, which is past the end
+// of the arrays, as it needs neither a weight nor a parent. Every other node comes before its parent, so the depths of
+// all the nodes follow from a single pass that goes down from the root.
+struct HuffmanTree {
+    HuffmanTree(int category_count) :
+        root_node_index(2 * category_count - 2),
+        category_count(category_count),
+        internal_node_end(category_count),
+        weights(2 * category_count - 2),
+        parent_indices(2 * category_count - 2),
+        labels(2 * category_count - 2),
+        depths(2 * category_count - 1),
+        sorted_leaves(category_count) {
+        for (int i = 0; i < category_count; i++) {
+            sorted_leaves[i] = i;
+        }
+    }
+
+    // The lazy trees give the categories that take more than half of the remaining weight their own nodes on a chain of
+    // roots that goes down from the root of the tree. The rest of the tree hangs from the last one of them.
+    int root_node_index;
+    int category_count;
+
+    // The internal nodes that the construction has made so far are in [category_count, internal_node_end)
+    int internal_node_end;
+
+    std::vector<float> weights;
+    std::vector<int> parent_indices;
+    std::vector<Label> labels;
+    std::vector<int> depths; // Only used by the passes over the depths of the nodes
+
+    // The buffers of the builders that sort the leaves by their weights, kept so that a build allocates nothing. The
+    // builders that sort all the leaves leave them in the order of the last weights, which the next ones can start from.
+    std::vector<int> sorted_leaves;
+    WeightSorter sorter;
+    LengthLimiter length_limiter;
+
+    // Converts the weights of the categories, of any of the types that convert_weights takes, into the ones of the leaves
+    template <typename Weight>
+    void load_leaf_weights(const Weight* category_weights) {
+        convert_weights(category_weights, category_count, weights.data());
+    }
+
+    // The tree has to be complete. Costs O(V), compared to the O(V log V) of following the parents of every category.
+    void compute_code_lengths(int* code_lengths) {
+        const int* parents = parent_indices.data();
+        int* node_depths = depths.data();
+
+        node_depths[2 * category_count - 2] = 0;
+        for (int i = 2 * category_count - 3; i >= root_node_index; i--) {
+            node_depths[i] = node_depths[parents[i]] + 1;
+        }
+        for (int i = internal_node_end - 1; i >= category_count; i--) {
+            node_depths[i] = node_depths[parents[i]] + 1;
+        }
+        for (int i = 0; i < category_count; i++) {
+            code_lengths[i] = node_depths[parents[i]] + 1;
+        }
+    }
+
+    // Fills the lengths of an optimal code for the loaded weights with no code longer than max_code_length bits.
+    // Returns false if the categories do not fit into codes of that length.
+    bool limit_code_lengths(int max_code_length, int* code_lengths) {
+        int* leaves = sorted_leaves.data();
+        for (int i = 0; i < category_count; i++) {
+            leaves[i] = i;
+        }
+
+        sorter.sort(weights.data(), leaves, category_count, leaves);
+        return length_limiter.limit_code_lengths(weights.data(), leaves, category_count, max_code_length, code_lengths);
+    }
+
+    // Rebuilds the tree with the given code lengths, which have to fill the code space. Going up from the deepest, the
+    // nodes of every depth, the internal ones before the leaves, are paired in order under the new nodes of the depth
+    // above.
+    void load_code_lengths(const int* code_lengths) {
+        int max_length = *std::max_element(code_lengths, code_lengths + category_count);
+
+        // The leaves from the deepest to the shallowest. Once they are in place, the ones of a length end where the
+        // ones of the next shorter length start.
+        int* length_ends = depths.data();
+        std::fill(length_ends, length_ends + max_length + 1, 0);
+        for (int i = 0; i < category_count; i++) {
+            length_ends[code_lengths[i]]++;
+        }
+        for (int length = max_length, start = 0; length > 0; length--) {
+            int count = length_ends[length];
+            length_ends[length] = start;
+            start += count;
+        }
+
+        int* leaves = sorted_leaves.data();
+        for (int i = 0; i < category_count; i++) {
+            leaves[length_ends[code_lengths[i]]++] = i;
+        }
+
+        int level_begin = category_count; // The internal nodes of the current depth are in [level_begin, level_end)
+        int level_end = category_count;
+        int next_leaf = 0;
+
+        for (int length = max_length; length > 0; length--) {
+            int internal_count = level_end - level_begin;
+            int node_count = internal_count + length_ends[length] - next_leaf;
+            assert(node_count % 2 == 0 && (length > 1 || node_count == 2));
+
+            for (int i = 0; i < node_count; i++) {
+                int node = i < internal_count ? level_begin + i : leaves[next_leaf + i - internal_count];
+                int parent = length > 1 ? level_end + i / 2 : 2 * category_count - 2;
+
+                parent_indices[node] = parent;
+                labels[node] = i % 2 == 0 ? Label::ZERO : Label::ONE;
+                if (length > 1) {
+                    weights[parent] = i % 2 == 0 ? weights[node] : weights[parent] + weights[node];
+                }
+            }
+
+            next_leaf = length_ends[length];
+            level_begin = level_end;
+            level_end += length > 1 ? node_count / 2 : 0;
+        }
+
+        root_node_index = 2 * category_count - 2;
+        internal_node_end = level_end;
+    }
+};
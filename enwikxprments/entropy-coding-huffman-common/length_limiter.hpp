@@ -0,0 +1,91 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+// Finds the lengths of an optimal code with no code longer than a limit by package-merge. Every category is a coin of
+// its weight for each length up to the limit, worth 2^-length, and the lightest coins worth category_count - 1 in total
+// give every category as many bits as it has coins among them. The list of a length merges the categories with pairs of
+// the list of the next longer length, lightest first, and the coins are a prefix of every list, so all it takes is the
+// number of categories in the prefixes. Costs O(V * max_code_length), and the buffers are kept between the calls.
+class LengthLimiter {
+public:
+    // The categories have to be sorted by their weights, lightest first. Returns false if they do not fit into codes of
+    // max_code_length bits.
+    bool limit_code_lengths(const float* weights, const int* sorted_categories, int category_count, int max_code_length, int* code_lengths) {
+        if (max_code_length < 31 && 1 << max_code_length < category_count) {
+            return false;
+        }
+
+        // No code of an unlimited tree is longer than this
+        int level_count = std::min(max_code_length, category_count - 1);
+        int max_list_size = 2 * category_count;
+
+        // Every list ends with infinite weights, so that the merge takes from the other one once it runs out
+        leaf_weights.resize(category_count + 1);
+        lists[0].resize(max_list_size + 2);
+        lists[1].resize(max_list_size + 2);
+        leaf_flags.resize((size_t) level_count * max_list_size);
+        leaf_prefix_counts.resize(category_count + 1);
+
+        for (int i = 0; i < category_count; i++) {
+            leaf_weights[i] = weights[sorted_categories[i]];
+        }
+        leaf_weights[category_count] = std::numeric_limits<float>::infinity();
+
+        // The list of the longest codes has only the categories
+        float* list = lists[0].data();
+        float* merged = lists[1].data();
+        int list_size = category_count;
+        std::copy(leaf_weights.begin(), leaf_weights.end(), list);
+        std::fill(leaf_flags.begin() + (size_t) (level_count - 1) * max_list_size, leaf_flags.end(), 1);
+
+        // The merge decides between the fronts without a branch, as the decisions follow no pattern
+        for (int level = level_count - 2; level >= 0; level--) {
+            unsigned char* flags = leaf_flags.data() + (size_t) level * max_list_size;
+            int size = category_count + list_size / 2;
+            list[list_size + 1] = list[list_size] = std::numeric_limits<float>::infinity();
+
+            for (int i = 0, leaf = 0, package = 0; i < size; i++) {
+                float leaf_weight = leaf_weights[leaf];
+                float package_weight = list[2 * package] + list[2 * package + 1];
+                bool takes_leaf = leaf_weight <= package_weight;
+
+                merged[i] = takes_leaf ? leaf_weight : package_weight;
+                flags[i] = takes_leaf;
+                leaf += takes_leaf;
+                package += !takes_leaf;
+            }
+
+            std::swap(list, merged);
+            list_size = size;
+        }
+
+        // A category is in the prefix of as many lists as it has bits, and the lighter ones are in the longer prefixes
+        std::fill(leaf_prefix_counts.begin(), leaf_prefix_counts.end(), 0);
+        for (int level = 0, taken = 2 * category_count - 2; level < level_count; level++) {
+            const unsigned char* flags = leaf_flags.data() + (size_t) level * max_list_size;
+            int leaf_count = 0;
+            for (int i = 0; i < taken; i++) {
+                leaf_count += flags[i];
+            }
+
+            leaf_prefix_counts[leaf_count]++;
+            taken = 2 * (taken - leaf_count);
+        }
+
+        for (int i = category_count - 1, length = 0; i >= 0; i--) {
+            length += leaf_prefix_counts[i + 1];
+            code_lengths[sorted_categories[i]] = length;
+        }
+
+        return true;
+    }
+
+private:
+    std::vector<float> leaf_weights; // The weights of the sorted categories
+    std::vector<float> lists[2];
+    std::vector<unsigned char> leaf_flags; // For every length, whether the items of its list are categories or pairs
+    std::vector<int> leaf_prefix_counts; // How many of the lists take the first n categories, by n
+};
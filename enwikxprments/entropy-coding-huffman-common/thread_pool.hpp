@@ -0,0 +1,103 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Threads that wait for work between runs, so that a run does not have to start any. The calling thread takes part in
+// every run as thread 0.
+class ThreadPool {
+public:
+    ThreadPool(unsigned thread_count) : generation(0), running_workers(0), stopping(false) {
+        for (unsigned i = 1; i < thread_count; i++) {
+            workers.emplace_back(&ThreadPool::work, this, i);
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        work_available.notify_all();
+
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    unsigned thread_count() const {
+        return (unsigned) workers.size() + 1;
+    }
+
+    // Calls task(thread_index, begin, end) for chunks of [0, count), on whichever thread is free, and returns when all
+    // of them are done
+    void run(size_t count, size_t chunk_size, const std::function<void(unsigned, size_t, size_t)>& task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            this->task = &task;
+            this->count = count;
+            this->chunk_size = chunk_size;
+            next_chunk = 0;
+            running_workers = workers.size();
+            ++generation;
+        }
+        work_available.notify_all();
+
+        run_chunks(0);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        work_done.wait(lock, [this] { return running_workers == 0; });
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable work_available;
+    std::condition_variable work_done;
+    unsigned long long generation; // Counts the runs, so that a worker can tell a new one from the one it finished
+    size_t running_workers;
+    bool stopping;
+
+    const std::function<void(unsigned, size_t, size_t)>* task;
+    size_t count;
+    size_t chunk_size;
+    std::atomic<size_t> next_chunk;
+
+    void work(unsigned thread_index) {
+        unsigned long long finished_generation = 0;
+
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                work_available.wait(lock, [&] { return stopping || generation != finished_generation; });
+                if (stopping) {
+                    return;
+                }
+                finished_generation = generation;
+            }
+
+            run_chunks(thread_index);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                --running_workers;
+            }
+            work_done.notify_one();
+        }
+    }
+
+    void run_chunks(unsigned thread_index) {
+        for (;;) {
+            size_t begin = next_chunk.fetch_add(chunk_size);
+            if (begin >= count) {
+                return;
+            }
+            (*task)(thread_index, begin, std::min(begin + chunk_size, count));
+        }
+    }
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <string.h>
+#include <algorithm>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define WEIGHT_CONVERSION_AVX2
+#elif defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define WEIGHT_CONVERSION_SSE2
+#endif
+
+// The weights that the coders take besides floats, so that the outputs of a model can be passed as they are: doubles,
+// bfloat16s and 32-bit integers, which stand for fixed-point numbers of any scale, as only the ratios of the weights
+// matter. The coders work with floats, into which the weights are converted a vector at a time, the tail one at a time.
+
+// The upper half of a float, with its sign, its exponent and the top 7 bits of its mantissa
+struct BFloat16 {
+    unsigned short bits;
+};
+
+inline void convert_weights(const float* weights, int count, float* converted) {
+    std::copy(weights, weights + count, converted);
+}
+
+inline void convert_weights(const double* weights, int count, float* converted) {
+    int i = 0;
+
+#if defined(WEIGHT_CONVERSION_AVX2)
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(converted + i, _mm256_cvtpd_ps(_mm256_loadu_pd(weights + i)));
+    }
+#elif defined(WEIGHT_CONVERSION_SSE2)
+    for (; i + 4 <= count; i += 4) {
+        __m128 low = _mm_cvtpd_ps(_mm_loadu_pd(weights + i));
+        __m128 high = _mm_cvtpd_ps(_mm_loadu_pd(weights + i + 2));
+        _mm_storeu_ps(converted + i, _mm_movelh_ps(low, high));
+    }
+#endif
+
+    for (; i < count; i++) {
+        converted[i] = (float) weights[i];
+    }
+}
+
+// Every half goes into the top of its float, under which the zeros are interleaved
+inline void convert_weights(const BFloat16* weights, int count, float* converted) {
+    int i = 0;
+
+#if defined(WEIGHT_CONVERSION_AVX2)
+    for (; i + 8 <= count; i += 8) {
+        __m256i halves = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(converted + i), _mm256_slli_epi32(halves, 16));
+    }
+#elif defined(WEIGHT_CONVERSION_SSE2)
+    __m128i zeros = _mm_setzero_si128();
+    for (; i + 8 <= count; i += 8) {
+        __m128i halves = _mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(converted + i), _mm_unpacklo_epi16(zeros, halves));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(converted + i + 4), _mm_unpackhi_epi16(zeros, halves));
+    }
+#endif
+
+    for (; i < count; i++) {
+        unsigned bits = (unsigned) weights[i].bits << 16;
+        memcpy(converted + i, &bits, sizeof(bits));
+    }
+}
+
+inline void convert_weights(const int* weights, int count, float* converted) {
+    int i = 0;
+
+#if defined(WEIGHT_CONVERSION_AVX2)
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(converted + i, _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + i))));
+    }
+#elif defined(WEIGHT_CONVERSION_SSE2)
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(converted + i, _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + i))));
+    }
+#endif
+
+    for (; i < count; i++) {
+        converted[i] = (float) weights[i];
+    }
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+// Sorts categories by their weights with a radix sort of the bits of the floats. With the sign bit flipped, and all the
+// bits of the negative ones, the bits of floats are in the same order as the floats. Each category is sorted as one
+// 64-bit item, its key above its index, a byte at a time from the lowest; a byte that is the same for every item, as the
+// top ones often are, is skipped. The bytes of the indices are only sorted when the indices do not come in order
+// already, as the sort keeps the order of the items whose bytes are the same. The buffers are kept between the sorts,
+// which allocate nothing after the first one.
+class WeightSorter {
+public:
+    // Fills sorted with the indices in the order of their weights, equal weights in the order of the indices. The
+    // indices may be sorted in place.
+    void sort(const float* weights, const int* indices, int count, int* sorted) {
+        if (count == 0) {
+            return;
+        }
+
+        items.resize(count);
+        scratch.resize(count);
+
+        unsigned counts[ITEM_BYTES][BUCKETS] = {};
+        bool in_order = true;
+        for (int i = 0; i < count; i++) {
+            unsigned long long item = (unsigned long long) sort_key(weights[indices[i]]) << 32 | (unsigned) indices[i];
+            items[i] = item;
+            in_order = in_order && (i == 0 || indices[i - 1] < indices[i]);
+
+            for (int byte = 0; byte < ITEM_BYTES; byte++) {
+                counts[byte][item >> (8 * byte) & (BUCKETS - 1)]++;
+            }
+        }
+
+        unsigned long long* source = items.data();
+        unsigned long long* destination = scratch.data();
+
+        for (int byte = in_order ? ITEM_BYTES - KEY_BYTES : 0; byte < ITEM_BYTES; byte++) {
+            int shift = 8 * byte;
+            if (counts[byte][source[0] >> shift & (BUCKETS - 1)] == (unsigned) count) {
+                continue;
+            }
+
+            unsigned offsets[BUCKETS];
+            for (unsigned bucket = 0, offset = 0; bucket < BUCKETS; bucket++) {
+                offsets[bucket] = offset;
+                offset += counts[byte][bucket];
+            }
+
+            for (int i = 0; i < count; i++) {
+                destination[offsets[source[i] >> shift & (BUCKETS - 1)]++] = source[i];
+            }
+
+            std::swap(source, destination);
+        }
+
+        for (int i = 0; i < count; i++) {
+            sorted[i] = (int) (unsigned) source[i];
+        }
+    }
+
+    // Sorts the categories again when they are sorted by weights that differ little from these. Wherever a category
+    // comes before the one before it, both are taken out, which leaves the rest sorted; the ones taken out are sorted on
+    // their own and merged back. Once more than a part of them has to be taken out, they are all sorted instead. The
+    // order is the one that sort gives, equal weights in the order of the indices, whatever the order of the last ones.
+    void resort(const float* weights, int* sorted, int count) {
+        displaced.resize(count);
+        int max_displaced_count = count / MAX_DISPLACED_PART;
+        int kept_count = 0;
+        int displaced_count = 0;
+
+        for (int i = 0; i < count; i++) {
+            int category = sorted[i];
+            if (kept_count > 0 && comes_before(weights, category, sorted[kept_count - 1])) {
+                displaced[displaced_count++] = sorted[--kept_count];
+                displaced[displaced_count++] = category;
+
+                if (displaced_count > max_displaced_count) {
+                    std::copy(displaced.begin(), displaced.begin() + displaced_count, sorted + kept_count);
+                    sort(weights, sorted, count, sorted);
+                    return;
+                }
+            }
+            else {
+                sorted[kept_count++] = category;
+            }
+        }
+
+        sort(weights, displaced.data(), displaced_count, displaced.data());
+
+        // From the heaviest, so that the kept categories are moved before their places are taken
+        for (int i = count - 1, kept = kept_count - 1, other = displaced_count - 1; other >= 0; i--) {
+            if (kept >= 0 && comes_before(weights, displaced[other], sorted[kept])) {
+                sorted[i] = sorted[kept--];
+            }
+            else {
+                sorted[i] = displaced[other--];
+            }
+        }
+    }
+
+private:
+    static const int KEY_BYTES = 4;
+    static const int ITEM_BYTES = 8;
+    static const int MAX_DISPLACED_PART = 4;
+    static const unsigned BUCKETS = 256;
+
+    std::vector<unsigned long long> items;
+    std::vector<unsigned long long> scratch;
+    std::vector<int> displaced;
+
+    static bool comes_before(const float* weights, int lhs, int rhs) {
+        return weights[lhs] < weights[rhs] || (weights[lhs] == weights[rhs] && lhs < rhs);
+    }
+
+    // Adding 0 turns -0 into 0, which the builders that compare the floats take for the same weight
+    static unsigned sort_key(float weight) {
+        unsigned bits;
+        weight += 0.0f;
+        memcpy(&bits, &weight, sizeof(bits));
+
+        return bits ^ ((unsigned) ((int) bits >> 31) | 0x80000000u);
+    }
+};
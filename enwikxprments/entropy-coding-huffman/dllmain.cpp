@@ -0,0 +1,267 @@
+#include <Windows.h>
+
+#include <assert.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <random>
+
+#include "huffman_builders.hpp"
+#include "huffman_tree.hpp"
+
+BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReserved)
+{
+    return TRUE;
+}
+
+// The builders of the other Huffman libraries, in one. The lazy ones give the categories that take more than half of the
+// weight their own nodes and build the rest of the tree only once a code needs it, which pays off when the code of one
+// of them is all that is needed, and the two-queue ones sort the leaves first instead of keeping them in a heap. They
+// all break ties the same way, so the strategy only changes how fast a load is, not the codes it gives.
+enum class Strategy : int {
+    HEAP,
+    HEAP_LAZY,
+    TWO_QUEUES,
+    TWO_QUEUES_LAZY
+};
+
+const int STRATEGY_COUNT = 4;
+
+struct StrategyTree : HuffmanTree {
+    StrategyTree(int category_count) : HuffmanTree(category_count), strategy(Strategy::TWO_QUEUES) {}
+
+    Strategy strategy; // The one that the weights were loaded with, whose builder completes a lazy tree
+};
+
+typedef StrategyTree ExportedTree;
+
+// The strategy for a load is looked up by the number of bits of the largest category and by how many times the weight
+// of the other categories halves, up to 1 / 16, compared to the total: the lazy builders only help once a category
+// takes half of it. The defaults are the fastest of a load and a code length on an x64 build; calibrate_strategies
+// measures them again on the machine that runs the library.
+const int CATEGORY_BIT_BUCKETS = 16;
+const int SHARE_BUCKETS = 5;
+
+struct StrategyTable {
+    Strategy strategies[CATEGORY_BIT_BUCKETS][SHARE_BUCKETS];
+};
+
+const Strategy H = Strategy::HEAP;
+const Strategy HL = Strategy::HEAP_LAZY;
+const Strategy Q = Strategy::TWO_QUEUES;
+const Strategy QL = Strategy::TWO_QUEUES_LAZY;
+
+const StrategyTable DEFAULT_STRATEGY_TABLE = {{
+    {H, H, H, H, H},
+    {H, HL, HL, HL, HL},
+    {H, HL, HL, HL, HL},
+    {H, HL, HL, HL, HL},
+    {H, HL, HL, HL, HL},
+    {Q, QL, QL, QL, QL},
+    {Q, QL, QL, QL, QL},
+    {Q, QL, QL, QL, QL},
+    {Q, QL, QL, QL, QL},
+    {Q, QL, QL, QL, QL},
+    {Q, QL, QL, QL, QL},
+    {Q, QL, QL, QL, QL},
+    {Q, QL, QL, QL, QL},
+    {Q, Q, QL, QL, QL},
+    {Q, Q, Q, Q, QL},
+    {Q, Q, Q, Q, Q},
+}};
+
+// A table is never changed once the loads can see it: calibrate_strategies and set_strategy_table make a new one and
+// swap the pointer, so a load reads either the old table or the new one whole. The replaced tables are kept until the
+// library is unloaded, as a load may still be reading one.
+std::atomic<const StrategyTable*> strategy_table(&DEFAULT_STRATEGY_TABLE);
+std::vector<std::unique_ptr<StrategyTable>> replaced_strategy_tables;
+std::mutex strategy_table_mutex; // Held while a new table is made, so that two of them do not lose each other's changes
+
+void publish_strategy_table(std::unique_ptr<StrategyTable> table) {
+    strategy_table.store(table.get());
+    replaced_strategy_tables.push_back(std::move(table));
+}
+
+int category_bit_bucket(int category_count) {
+    int bits = 1;
+    while (bits < CATEGORY_BIT_BUCKETS && 1 << bits < category_count) {
+        bits++;
+    }
+    return bits - 1;
+}
+
+int share_bucket(float max_weight, float total_weight) {
+    float other_weight = total_weight - max_weight;
+    int bucket = 0;
+    while (bucket < SHARE_BUCKETS - 1 && other_weight <= total_weight / (2 << bucket)) {
+        bucket++;
+    }
+    return bucket;
+}
+
+// What every strategy does with the leaves: whether a load only puts the heaviest ones on the chain of roots, and how
+// the tree of the rest of them is built
+struct Builder {
+    bool lazy;
+    void (*build)(HuffmanTree* tree, int leaf_count);
+};
+
+const Builder BUILDERS[STRATEGY_COUNT] = {
+    {false, build_with_heap},
+    {true, build_with_heap},
+    {false, build_with_queues},
+    {true, build_with_queues},
+};
+
+// The weights have to be in the tree already
+void build_tree(StrategyTree* tree, Strategy strategy) {
+    const Builder& builder = BUILDERS[(int) strategy];
+    tree->strategy = strategy;
+
+    if (builder.lazy) {
+        separate_dominant_leaves(tree);
+        return;
+    }
+
+    tree->root_node_index = 2 * tree->category_count - 2;
+    builder.build(tree, collect_all_leaves(tree));
+}
+
+void initialize_full_tree(StrategyTree* tree) {
+    BUILDERS[(int) tree->strategy].build(tree, collect_unparented_leaves(tree));
+}
+
+// Loads the weights, of any of the types that convert_weights takes, with the strategy that the table gives for their
+// number and for the share of the heaviest one
+template <typename Weight>
+void load_typed_weights(StrategyTree* tree, const Weight* weights) {
+    tree->load_leaf_weights(weights);
+
+    float total_weight = 0;
+    float max_weight = 0;
+
+    for (int i = 0; i < tree->category_count; i++) {
+        total_weight += tree->weights[i];
+        max_weight = std::max(max_weight, tree->weights[i]);
+    }
+
+    const StrategyTable* table = strategy_table.load();
+    Strategy strategy = table->strategies[category_bit_bucket(tree->category_count)][share_bucket(max_weight, total_weight)];
+    build_tree(tree, strategy);
+}
+
+void load_batch_step(StrategyTree* tree, float* weights) {
+    load_typed_weights(tree, weights);
+}
+
+#include "huffman_exports.hpp"
+
+extern "C" {
+
+__declspec(dllexport) void load_weights_with_strategy(StrategyTree* tree, float* weights, int strategy) {
+    assert(strategy >= 0 && strategy < STRATEGY_COUNT);
+
+    tree->load_leaf_weights(weights);
+    build_tree(tree, (Strategy) strategy);
+}
+
+// The strategy that the weights were last loaded with
+__declspec(dllexport) int get_strategy(StrategyTree* tree) {
+    return (int) tree->strategy;
+}
+
+// Fills the table with the fastest strategy for every bucket, up to max_category_count categories, or for all of them
+// if it is 0. A strategy is timed on loads of weights that fall off like the predictions of a language model, as
+// 1 / rank in a random order, with the heaviest one in the middle of the shares of the bucket, each load followed by the
+// code length of a category that is drawn from the weights, the way the notebooks use the trees. The best of a few
+// rounds counts, and every round builds about as many leaves whatever the number of categories. Takes a few seconds
+// for all of them. The new table replaces the old one only at the end, and the loads in between use the old one.
+__declspec(dllexport) void calibrate_strategies(int max_category_count) {
+    const int ROUND_COUNT = 3;
+    const int LEAVES_PER_ROUND = 1 << 15;
+    std::mt19937 generator(0);
+
+    std::lock_guard<std::mutex> lock(strategy_table_mutex);
+    std::unique_ptr<StrategyTable> table(new StrategyTable(*strategy_table.load()));
+
+    for (int bits = 1; bits <= CATEGORY_BIT_BUCKETS; bits++) {
+        int category_count = 1 << bits;
+        if (max_category_count > 0 && category_count / 2 >= max_category_count) {
+            break;
+        }
+
+        StrategyTree tree(category_count);
+        std::vector<float> weights(category_count);
+        std::vector<int> categories(std::max(LEAVES_PER_ROUND / category_count, 1));
+
+        for (int bucket = 0; bucket < SHARE_BUCKETS; bucket++) {
+            double other_weight = 0;
+            for (int i = 1; i < category_count; i++) {
+                weights[i] = 1.0f / (i + 1);
+                other_weight += weights[i];
+            }
+
+            // The other categories take 3/4 of the weight that the bucket leaves them at most
+            double other_share = bucket > 0 ? 3.0 / (4 << bucket) : 1 - 1 / (other_weight + 1);
+            weights[0] = (float) (other_weight * (1 - other_share) / other_share);
+
+            for (int i = category_count - 1; i > 0; i--) {
+                std::swap(weights[i], weights[generator() % (i + 1)]);
+            }
+
+            std::discrete_distribution<int> distribution(weights.begin(), weights.end());
+            for (int& category : categories) {
+                category = distribution(generator);
+            }
+
+            Strategy fastest_strategy = Strategy::TWO_QUEUES;
+            double fastest_time = std::numeric_limits<double>::infinity();
+
+            for (int strategy = 0; strategy < STRATEGY_COUNT; strategy++) {
+                for (int round = 0; round < ROUND_COUNT; round++) {
+                    auto start = std::chrono::steady_clock::now();
+                    for (int category : categories) {
+                        load_weights_with_strategy(&tree, weights.data(), strategy);
+                        get_code_length(&tree, category);
+                    }
+                    std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+
+                    if (time.count() < fastest_time) {
+                        fastest_strategy = (Strategy) strategy;
+                        fastest_time = time.count();
+                    }
+                }
+            }
+
+            table->strategies[bits - 1][bucket] = fastest_strategy;
+        }
+    }
+
+    publish_strategy_table(std::move(table));
+}
+
+// The table is CATEGORY_BIT_BUCKETS rows of SHARE_BUCKETS strategies, so that a calibration can be kept and loaded
+__declspec(dllexport) void get_strategy_table(int* strategies) {
+    const StrategyTable* table = strategy_table.load();
+
+    for (int i = 0; i < CATEGORY_BIT_BUCKETS * SHARE_BUCKETS; i++) {
+        strategies[i] = (int) table->strategies[i / SHARE_BUCKETS][i % SHARE_BUCKETS];
+    }
+}
+
+__declspec(dllexport) void set_strategy_table(const int* strategies) {
+    std::unique_ptr<StrategyTable> table(new StrategyTable());
+
+    for (int i = 0; i < CATEGORY_BIT_BUCKETS * SHARE_BUCKETS; i++) {
+        assert(strategies[i] >= 0 && strategies[i] < STRATEGY_COUNT);
+        table->strategies[i / SHARE_BUCKETS][i % SHARE_BUCKETS] = (Strategy) strategies[i];
+    }
+
+    std::lock_guard<std::mutex> lock(strategy_table_mutex);
+    publish_strategy_table(std::move(table));
+}
+
+}
\ No newline at end of file
@@ -56,7 +56,8 @@ public:
         codec_denominator = 1;
     }
 
-    void load_ranges(float* ranges) {
+    template <typename Weight>
+    void load_ranges(const Weight* ranges) {
         this->ranges.load_ranges(ranges);
     }
 
@@ -158,7 +159,8 @@ public:
     Decoder() {
     }
 
-    void load_ranges(float* ranges) {
+    template <typename Weight>
+    void load_ranges(const Weight* ranges) {
         Codec< _CATEGORY_COUNT>::load_ranges(ranges);
         decoder_start_category = 0;
         decoder_end_category = _CATEGORY_COUNT - 1;
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <stddef.h>
+#include <algorithm>
+#include <vector>
+
+#include "ranges.hpp"
+
+// A range coder that keeps the interval in machine words rather than in the fractions of Codec. The low end and the
+// length of the interval are 64-bit; once the length drops under 2^56, the top byte of the low end is written out and
+// both are shifted left by a byte, so the length always has more than 56 bits. A category takes its range of the
+// ScaledRanges in units of length / total, rounded down, with the last category taking what is left, so the ranges of
+// the categories lose less than a 2^-(56 - ScaledRanges::TOTAL_BITS) part of their lengths in the ScaledRanges.
+// Adding to the low end can carry into the bytes that are already written, which are still in memory.
+template <int _CATEGORY_COUNT>
+class FixedPrecisionCodec {
+public:
+    FixedPrecisionCodec() {
+        codec_length = ~0ull;
+    }
+
+    template <typename Weight>
+    void load_ranges(const Weight* ranges) {
+        this->ranges.load_ranges(ranges);
+    }
+
+protected:
+    static const int SHIFT_BITS = 8;
+    static const int LOW_BITS = 64 - SHIFT_BITS;
+    static const unsigned __int64 MIN_LENGTH = 1ull << LOW_BITS;
+
+    unsigned __int64 codec_length;
+
+    ScaledRanges<_CATEGORY_COUNT> ranges;
+
+    // Narrows the length to the range of the category, and returns how far the interval starts into the old one
+    unsigned __int64 narrow(short category, unsigned __int64 unit) {
+        unsigned __int64 offset = unit * ranges.start(category);
+
+        if (category == _CATEGORY_COUNT - 1) {
+            codec_length -= offset;
+        }
+        else {
+            codec_length = unit * ranges.length(category);
+        }
+        return offset;
+    }
+};
+
+template <int _CATEGORY_COUNT>
+class FixedPrecisionEncoder : public FixedPrecisionCodec<_CATEGORY_COUNT> {
+public:
+    FixedPrecisionEncoder() {
+        codec_low = 0;
+    }
+
+    void encode(short category) {
+        unsigned __int64 unit = this->codec_length / this->ranges.total();
+        unsigned __int64 low = codec_low + this->narrow(category, unit);
+
+        if (low < codec_low) {
+            carry();
+        }
+        codec_low = low;
+
+        while (this->codec_length < this->MIN_LENGTH) {
+            encoded_bytes.push_back((unsigned char) (codec_low >> this->LOW_BITS));
+            codec_low <<= this->SHIFT_BITS;
+            this->codec_length <<= this->SHIFT_BITS;
+        }
+    }
+
+    // Writes the top byte of the first number in the interval with nothing below it. The decoder reads zeros past the
+    // end of the data, so the zero bytes at the end are left out.
+    void encode_end() {
+        unsigned __int64 rounded_low = codec_low + (this->MIN_LENGTH - 1);
+
+        if (rounded_low < codec_low) {
+            carry();
+        }
+        encoded_bytes.push_back((unsigned char) (rounded_low >> this->LOW_BITS));
+
+        while (!encoded_bytes.empty() && encoded_bytes.back() == 0) {
+            encoded_bytes.pop_back();
+        }
+    }
+
+    const std::vector<unsigned char>& data() {
+        return encoded_bytes;
+    }
+
+private:
+    unsigned __int64 codec_low;
+
+    std::vector<unsigned char> encoded_bytes;
+
+    // The interval never reaches past the one it started as, so some byte takes the carry without overflowing
+    void carry() {
+        size_t i = encoded_bytes.size() - 1;
+        while (encoded_bytes[i] == 0xFF) {
+            encoded_bytes[i--] = 0;
+        }
+        encoded_bytes[i]++;
+    }
+};
+
+// Keeps the offset of the encoded number into the interval instead of the low end, which the carries do not affect
+template <int _CATEGORY_COUNT>
+class FixedPrecisionDecoder : public FixedPrecisionCodec<_CATEGORY_COUNT> {
+public:
+    FixedPrecisionDecoder(const unsigned char* data, size_t size) : encoded_bytes(data), encoded_size(size) {
+        next_byte = 0;
+        codec_offset = 0;
+
+        for (int i = 0; i < 64 / this->SHIFT_BITS; i++) {
+            codec_offset = codec_offset << this->SHIFT_BITS | read_byte();
+        }
+    }
+
+    short decode() {
+        unsigned __int64 unit = this->codec_length / this->ranges.total();
+        unsigned __int64 target = std::min(codec_offset / unit, this->ranges.total() - 1);
+        short category = this->ranges.find_category(target);
+
+        codec_offset -= this->narrow(category, unit);
+
+        while (this->codec_length < this->MIN_LENGTH) {
+            codec_offset = codec_offset << this->SHIFT_BITS | read_byte();
+            this->codec_length <<= this->SHIFT_BITS;
+        }
+
+        decoded_categories.push_back(category);
+        return category;
+    }
+
+    const std::vector<short>& data() {
+        return decoded_categories;
+    }
+
+private:
+    const unsigned char* encoded_bytes;
+    size_t encoded_size;
+    size_t next_byte;
+
+    unsigned __int64 codec_offset;
+
+    std::vector<short> decoded_categories;
+
+    unsigned char read_byte() {
+        return next_byte < encoded_size ? encoded_bytes[next_byte++] : 0;
+    }
+};
@@ -6,6 +6,7 @@
 #include <string>
 
 #include "codec.hpp"
+#include "fixed_precision_codec.hpp"
 
 #define CATEGORY_COUNT 255
 
@@ -30,6 +31,48 @@ int main()
     std::chrono::steady_clock::time_point start_time, end_time;
     std::chrono::steady_clock::duration time;
     double miliseconds;
+    double microseconds;
+
+    start_time = std::chrono::high_resolution_clock::now();
+    FixedPrecisionEncoder<CATEGORY_COUNT> fixed_precision_encoder;
+    for (int i = 0; i < length; i++) {
+        fixed_precision_encoder.load_ranges(weights[i]);
+        fixed_precision_encoder.encode(actual[i]);
+    }
+    fixed_precision_encoder.encode_end();
+    end_time = std::chrono::high_resolution_clock::now();
+    time = end_time - start_time;
+    microseconds = time / std::chrono::microseconds(1);
+    printf("Took %lf us.\n", microseconds);
+    printf("Compressed length: %d\n", fixed_precision_encoder.data().size() * 8);
+
+    start_time = std::chrono::high_resolution_clock::now();
+    FixedPrecisionDecoder<CATEGORY_COUNT> fixed_precision_decoder(fixed_precision_encoder.data().data(), fixed_precision_encoder.data().size());
+    for (int i = 0; i < length; i++) {
+        fixed_precision_decoder.load_ranges(weights[i]);
+        fixed_precision_decoder.decode();
+    }
+    end_time = std::chrono::high_resolution_clock::now();
+    time = end_time - start_time;
+    microseconds = time / std::chrono::microseconds(1);
+    printf("Took %lf us.\n", microseconds);
+    printf("Decompressed length: %d\n", fixed_precision_decoder.data().size());
+
+    for (int i = 0; i < length; i++) {
+        if (fixed_precision_decoder.data()[i] != actual[i]) {
+            puts("ERROR!");
+            throw "ERROR";
+        }
+    }
+
+    // The same symbols as the exact coder below, to compare the lengths
+    FixedPrecisionEncoder<CATEGORY_COUNT> prefix_encoder;
+    for (int i = 0; i < 250; i++) {
+        prefix_encoder.load_ranges(weights[i]);
+        prefix_encoder.encode(actual[i]);
+    }
+    prefix_encoder.encode_end();
+    printf("Compressed length of the first 250: %d\n", prefix_encoder.data().size() * 8);
 
     start_time = std::chrono::high_resolution_clock::now();
     Encoder<CATEGORY_COUNT> encoder;
@@ -4,6 +4,8 @@
 #include <array>
 #include <vector>
 
+#include "weight_conversion.hpp"
+
 union Float {
     Float() {}
     Float(float f) : f(f) {}
@@ -24,22 +26,37 @@ public:
 	void load_ranges(const float* ranges) {
         const Float* f_ranges = reinterpret_cast<const Float*>(ranges);
         unsigned min_exponent = -1;
+        unsigned max_exponent = 0;
 
         for (int i = 0; i < CATEGORY_COUNT; i++) {
             min_exponent = std::min(min_exponent, f_ranges[i].exponent);
+            max_exponent = std::max(max_exponent, f_ranges[i].exponent);
         }
 
+        // Past 64 binades the heaviest ranges would overflow the total, so the lightest ones are let go to nothing instead
+        int base_exponent = std::max((int) min_exponent + 32, (int) max_exponent - 32);
+
         category_ranges[0] = 0;
 
+        // Every length starts at the top of the word and is shifted right, without a branch on the direction, which the
+        // exponents make unpredictable
         for (int i = 0; i < CATEGORY_COUNT; i++) {
-            int exponent = (int) f_ranges[i].exponent - min_exponent - 32;
-            unsigned __int64 range_length = (1 << 23) | f_ranges[i].mantissa;
-            range_length = exponent > 0 ? range_length << exponent : range_length >> -exponent;
+            unsigned shift = base_exponent + 40 - (int) f_ranges[i].exponent;
+            unsigned __int64 range_length = (unsigned __int64) ((1 << 23) | f_ranges[i].mantissa) << 40;
+            range_length = (range_length >> (shift & 63)) & (0ull - (shift < 64));
             
             category_ranges[i + 1] = category_ranges[i] + range_length;
         }
 	}
 
+    // Weights of the other types that convert_weights takes go through floats
+    template <typename Weight>
+    void load_ranges(const Weight* ranges) {
+        float converted_ranges[CATEGORY_COUNT];
+        convert_weights(ranges, CATEGORY_COUNT, converted_ranges);
+        load_ranges(static_cast<const float*>(converted_ranges));
+    }
+
     unsigned __int64 start(int category) const {
         return category_ranges[category];
     }
@@ -58,3 +75,91 @@ public:
 private:
     unsigned __int64 category_ranges[CATEGORY_COUNT + 1];
 };
+
+// Ranges with their total brought to TOTAL_BITS bits, for the coders that work with machine words. Unlike Ranges, the
+// weights are quantized from the heaviest one down: it gets a length under 2^56, so the lengths of 256 categories
+// still add up within 64 bits, and every weight within 32 binades of it keeps its whole mantissa, however flat the
+// weights are. The bounds are then shifted rather than the lengths, so the ranges still cover the total without gaps,
+// and the bound of every category is raised by its index, so that none of them is empty, not even the ones more than
+// 56 binades under the heaviest. Both cost less than a 2^-(TOTAL_BITS - 9) part of the total.
+template <int CATEGORY_COUNT>
+class ScaledRanges {
+public:
+    static const int TOTAL_BITS = 32;
+
+    static_assert(CATEGORY_COUNT <= 256, "The lengths of more categories could overflow the 64-bit total");
+
+    ScaledRanges() {}
+
+    void load_ranges(const float* ranges) {
+        const Float* f_ranges = reinterpret_cast<const Float*>(ranges);
+        unsigned max_exponent = 0;
+
+        for (int i = 0; i < CATEGORY_COUNT; i++) {
+            max_exponent = std::max(max_exponent, (unsigned) f_ranges[i].exponent);
+        }
+
+        // The same branchless shift as in Ranges, with the heaviest weight 8 bits under the top of the word
+        unsigned __int64 bound = 0;
+        for (int i = 0; i < CATEGORY_COUNT; i++) {
+            unsigned shift = max_exponent + 8 - f_ranges[i].exponent;
+            unsigned __int64 range_length = (unsigned __int64) ((1 << 23) | f_ranges[i].mantissa) << 40;
+            bound += (range_length >> (shift & 63)) & (0ull - (shift < 64));
+
+            category_ends[i] = bound;
+        }
+
+        // The heaviest length alone is at least 2^55, so the total only ever has to come down
+        int right_shift = 0;
+        while (bound >> right_shift >= 1ull << TOTAL_BITS) {
+            right_shift++;
+        }
+        for (int i = 0; i < CATEGORY_COUNT; i++) {
+            category_ends[i] = (category_ends[i] >> right_shift) + i + 1;
+        }
+    }
+
+    // Weights of the other types that convert_weights takes go through floats
+    template <typename Weight>
+    void load_ranges(const Weight* ranges) {
+        float converted_ranges[CATEGORY_COUNT];
+        convert_weights(ranges, CATEGORY_COUNT, converted_ranges);
+        load_ranges(static_cast<const float*>(converted_ranges));
+    }
+
+    unsigned __int64 start(int category) const {
+        return category == 0 ? 0 : category_ends[category - 1];
+    }
+
+    unsigned __int64 length(int category) const {
+        return end(category) - start(category);
+    }
+
+    unsigned __int64 end(int category) const {
+        return category_ends[category];
+    }
+
+    unsigned __int64 total() const {
+        return end(CATEGORY_COUNT - 1);
+    }
+
+    // The category whose range contains the target, which has to be less than the total
+    short find_category(unsigned __int64 target) const {
+        int start = 0;
+        int end = CATEGORY_COUNT - 1;
+
+        while (start < end) {
+            int middle = (start + end) / 2;
+
+            if (this->end(middle) <= target) {
+                start = middle + 1;
+            }
+            else {
+                end = middle;
+            }
+        }
+        return start;
+    }
+private:
+    unsigned __int64 category_ends[CATEGORY_COUNT];
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "page_revision.hpp"
+#include "text_corpus.hpp"
+
+// The article as the notebooks read it from page_revisions_text_with_title: the title between equal signs on a line of
+// its own, followed by the text
+inline void formatArticle(const PageRevision& pageRevision, std::string& article) {
+    article.clear();
+    article.reserve(pageRevision.pageTitle.size() + pageRevision.revisionText.size() + 3);
+    article += '=';
+    article += pageRevision.pageTitle;
+    article += "=\n";
+    article += pageRevision.revisionText;
+}
+
+// The articles of the page revisions, which have to stay alive for as long as this does
+class ArticleCorpus : public TextCorpus {
+public:
+    ArticleCorpus(const PageRevisions& pageRevisions) {
+        for (const PageRevision& pageRevision : pageRevisions) {
+            articles.push_back(pageRevision);
+        }
+    }
+
+    size_t size() const override {
+        return articles.size();
+    }
+
+    void getText(size_t index, std::string& text) const override {
+        formatArticle(articles[index], text);
+    }
+
+private:
+    std::vector<PageRevision> articles;
+};
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "binary_reader.hpp"
+
+// Lays out the training batches of the notebooks' Articles.dataset in one file that the trainer only has to map and
+// slice. The articles of <prefix>.tokens are sorted by length and taken batchSize at a time, with empty articles in
+// front of the shortest ones so that the count divides evenly. Every such group is padded with zeros to its longest
+// article and cut into windows of batchedItemLength + 1 tokens that overlap by one, with an extra window of zeros when
+// the last one is full, just like subbatch_generator cuts them.
+//
+// The file holds, in order:
+//   uint64 batchSize, batchedItemLength, groupCount, epochCount, windowCount, windowsOffset
+//   uint64 firstWindows[groupCount + 1]: the windows of group g are [firstWindows[g], firstWindows[g + 1])
+//   uint64 permutations[epochCount][groupCount]: the order of the groups in every epoch
+//   int16 windows[windowCount][batchSize][batchedItemLength + 1], starting at windowsOffset
+//
+// The windows of a group stay together and in order, as the stateful model needs them; only the groups are shuffled.
+class BatchPacker {
+public:
+    static const size_t HEADER_SIZE = 6 * sizeof(uint64_t);
+    static const size_t WINDOWS_ALIGNMENT = 1 << 12;
+
+    BatchPacker(const std::string& tokensPrefix, size_t batchSize, size_t batchedItemLength):
+        tokens(tokensPrefix + ".tokens"), offsets(tokensPrefix + ".offsets"), batchSize(batchSize), batchedItemLength(batchedItemLength) {
+        if (batchSize == 0 || batchedItemLength == 0) {
+            throw std::runtime_error("The batch size and the batched item length have to be positive");
+        }
+
+        if (offsets.size() < sizeof(uint64_t)) {
+            throw std::runtime_error("'" + tokensPrefix + ".offsets' is empty");
+        }
+
+        articleCount = offsets.size() / sizeof(uint64_t) - 1;
+
+        // fillWindow copies the tokens that the offsets point to without checking them again
+        if (offsets.size() % sizeof(uint64_t) != 0) {
+            throw std::runtime_error("'" + tokensPrefix + ".offsets' does not hold whole uint64 offsets");
+        }
+        for (size_t i = 0; i < articleCount; i++) {
+            if (offset(i + 1) < offset(i)) {
+                throw std::runtime_error("The offsets of '" + tokensPrefix + ".offsets' decrease at article " + std::to_string(i));
+            }
+        }
+        if (tokens.size() % sizeof(int16_t) != 0 || offset(articleCount) != tokens.size() / sizeof(int16_t)) {
+            throw std::runtime_error("'" + tokensPrefix + ".offsets' does not end at the last token of '" + tokensPrefix + ".tokens'");
+        }
+
+        articles.resize(articleCount);
+        for (size_t i = 0; i < articleCount; i++) {
+            articles[i] = i;
+        }
+        std::stable_sort(articles.begin(), articles.end(), [this](size_t a, size_t b) {
+            return articleLength(a) < articleLength(b);
+        });
+
+        paddingCount = (batchSize - articleCount % batchSize) % batchSize;
+        groupCount = (paddingCount + articleCount) / batchSize;
+
+        firstWindows.push_back(0);
+        for (size_t group = 0; group < groupCount; group++) {
+            firstWindows.push_back(firstWindows.back() + windowCount(groupLength(group)));
+        }
+    }
+
+    size_t windowCount() const {
+        return firstWindows.back();
+    }
+
+    // The permutation of every epoch comes from a generator seeded with the epoch, so packing again gives the same file
+    void write(const std::string& filename, size_t epochCount) const {
+        FILE* file = fopen(filename.c_str(), "wb");
+        if (file == nullptr) {
+            throw std::runtime_error("Could not create '" + filename + "'");
+        }
+        setvbuf(file, nullptr, _IOFBF, 1 << 20);
+
+        size_t tablesSize = HEADER_SIZE + (groupCount + 1 + epochCount * groupCount) * sizeof(uint64_t);
+        uint64_t windowsOffset = (tablesSize + WINDOWS_ALIGNMENT - 1) / WINDOWS_ALIGNMENT * WINDOWS_ALIGNMENT;
+        uint64_t header[] = {batchSize, batchedItemLength, groupCount, epochCount, windowCount(), windowsOffset};
+        writeItems(file, header, sizeof(uint64_t), 6, filename);
+        writeItems(file, firstWindows.data(), sizeof(uint64_t), firstWindows.size(), filename);
+
+        std::vector<uint64_t> permutation(groupCount);
+        for (size_t epoch = 0; epoch < epochCount; epoch++) {
+            shuffle(permutation, epoch);
+            writeItems(file, permutation.data(), sizeof(uint64_t), permutation.size(), filename);
+        }
+
+        std::vector<char> alignment(windowsOffset - tablesSize, 0);
+        writeItems(file, alignment.data(), 1, alignment.size(), filename);
+
+        std::vector<int16_t> window(batchSize * (batchedItemLength + 1));
+        for (size_t group = 0; group < groupCount; group++) {
+            for (uint64_t i = 0; i < firstWindows[group + 1] - firstWindows[group]; i++) {
+                fillWindow(group, i * batchedItemLength, window);
+                writeItems(file, window.data(), sizeof(int16_t), window.size(), filename);
+            }
+        }
+
+        if (fclose(file) != 0) {
+            throw std::runtime_error("Could not write '" + filename + "'");
+        }
+    }
+
+private:
+    MappedFile tokens;
+    MappedFile offsets;
+    size_t batchSize;
+    size_t batchedItemLength;
+    size_t articleCount;
+    size_t paddingCount;
+    size_t groupCount;
+
+    std::vector<size_t> articles; // The indices of the articles, from the shortest to the longest
+    std::vector<uint64_t> firstWindows;
+
+    uint64_t offset(size_t article) const {
+        uint64_t result;
+        memcpy(&result, offsets.data() + article * sizeof(uint64_t), sizeof(uint64_t));
+        return result;
+    }
+
+    uint64_t articleLength(size_t article) const {
+        return offset(article + 1) - offset(article);
+    }
+
+    // The article in a row of a group, or articleCount for the padding in front of the first one
+    size_t rowArticle(size_t group, size_t row) const {
+        size_t position = group * batchSize + row;
+        return position < paddingCount ? articleCount : articles[position - paddingCount];
+    }
+
+    // The articles are sorted, so the last row of a group is the longest one
+    uint64_t groupLength(size_t group) const {
+        size_t article = rowArticle(group, batchSize - 1);
+        return article == articleCount ? 0 : articleLength(article);
+    }
+
+    uint64_t windowCount(uint64_t length) const {
+        uint64_t result = 1;
+        while (length > batchedItemLength + 1) {
+            length -= batchedItemLength;
+            result++;
+        }
+        return length == batchedItemLength + 1 ? result + 1 : result;
+    }
+
+    // A window after the first that would start on the last token of the group is the extra one of zeros
+    void fillWindow(size_t group, uint64_t start, std::vector<int16_t>& window) const {
+        std::fill(window.begin(), window.end(), 0);
+        if (start > 0 && start + 1 >= groupLength(group)) {
+            return;
+        }
+
+        for (size_t row = 0; row < batchSize; row++) {
+            size_t article = rowArticle(group, row);
+            if (article == articleCount || articleLength(article) <= start) {
+                continue;
+            }
+
+            uint64_t count = std::min<uint64_t>(articleLength(article) - start, batchedItemLength + 1);
+            const char* source = tokens.data() + (offset(article) + start) * sizeof(int16_t);
+            memcpy(window.data() + row * (batchedItemLength + 1), source, count * sizeof(int16_t));
+        }
+    }
+
+    // Closes the file before throwing, as write() does not get to
+    static void writeItems(FILE* file, const void* items, size_t itemSize, size_t count, const std::string& filename) {
+        if (fwrite(items, itemSize, count, file) != count) {
+            fclose(file);
+            throw std::runtime_error("Could not write '" + filename + "'");
+        }
+    }
+
+    // A Fisher-Yates shuffle of its own rather than std::shuffle, whose result differs between standard libraries
+    void shuffle(std::vector<uint64_t>& permutation, size_t epoch) const {
+        for (size_t i = 0; i < permutation.size(); i++) {
+            permutation[i] = i;
+        }
+
+        std::mt19937_64 generator(epoch);
+        for (size_t i = permutation.size(); i > 1; i--) {
+            std::swap(permutation[i - 1], permutation[generator() % i]);
+        }
+    }
+};
@@ -1,43 +1,48 @@
 #pragma once
 
-#include <fstream>
-#include <vector>
+#include <string.h>
+#include <string_view>
 
+#include "mapped_file.hpp"
+
+// Reads values and NUL-terminated strings one after the other from a mapped file. Nothing is copied: the strings point
+// into the mapping and are valid for as long as the file is mapped. A copy of a reader continues from the same position
+// independently of the original.
 class BinaryReader {
 public:
-    BinaryReader(const char* filename) {
-        std::ifstream file(filename, std::ios::binary | std::ios::ate);
-        std::streamsize size = file.tellg();
-        file.seekg(0, std::ios::beg);
-
-        index = 0;
-        data = std::vector<char>(size);
-        file.read(data.data(), size);
+    BinaryReader(): current(nullptr), end(nullptr) {
+    }
+
+    BinaryReader(const MappedFile& file): current(file.data()), end(file.data() + file.size()) {
     }
 
     template <typename T>
     T read() {
-        char* read_start = data.data() + index;
-        T result = *((T*) read_start);
-        index += sizeof(T);
+        T result;
+        memcpy(&result, current, sizeof(T));
+        current += sizeof(T);
 
         return result;
     }
 
-    char* read_string() {
-        char* read_start = data.data() + index;
-        int length = strlen(read_start) + 1;
-        char* result = new char[length];
-        memcpy(result, read_start, length);
-        index += length;
+    std::string_view read_string() {
+        const char* terminator = (const char*) memchr(current, '\0', end - current);
+        size_t length = terminator ? terminator - current : end - current;
+        std::string_view result(current, length);
+        current += terminator ? length + 1 : length;
 
         return result;
     }
 
-    bool has_more() {
-        return index < data.size();
+    bool has_more() const {
+        return current < end;
     }
+
+    const char* position() const {
+        return current;
+    }
+
 private:
-    std::vector<char> data;
-    int index;
+    const char* current;
+    const char* end;
 };
@@ -1,6 +1,8 @@
 #pragma once
 
-#include <string.h>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "binary_reader.hpp"
 
@@ -12,9 +14,9 @@ enum ContributorType: unsigned char {
 };
 
 struct ContributorWithIpAddress {
-    static std::vector<ContributorWithIpAddress> read() {
+    static std::vector<ContributorWithIpAddress> read(const MappedFile& file) {
         std::vector<ContributorWithIpAddress> result;
-        BinaryReader reader("C:\\Users\\joank\\work\\enwikxprments\\src\\extractor\\data\\contributors_with_ip_address");
+        BinaryReader reader(file);
 
         while (reader.has_more()) {
             ContributorWithIpAddress contributor;
@@ -34,9 +36,9 @@ struct ContributorWithIpAddress {
 };
 
 struct ContributorWithIpRange {
-    static std::vector<ContributorWithIpRange> read() {
+    static std::vector<ContributorWithIpRange> read(const MappedFile& file) {
         std::vector<ContributorWithIpRange> result;
-        BinaryReader reader("C:\\Users\\joank\\work\\enwikxprments\\src\\extractor\\data\\contributors_with_ip_range");
+        BinaryReader reader(file);
 
         while (reader.has_more()) {
             ContributorWithIpRange contributor;
@@ -55,9 +57,10 @@ struct ContributorWithIpRange {
 };
 
 struct ContributorWithIpString {
-    static std::vector<ContributorWithIpString> read() {
+    // The addresses point into the file
+    static std::vector<ContributorWithIpString> read(const MappedFile& file) {
         std::vector<ContributorWithIpString> result;
-        BinaryReader reader("C:\\Users\\joank\\work\\enwikxprments\\src\\extractor\\data\\contributors_with_ip_string");
+        BinaryReader reader(file);
 
         while (reader.has_more()) {
             ContributorWithIpString contributor;
@@ -70,14 +73,15 @@ struct ContributorWithIpString {
         return result;
     }
 
-    char* ip;
+    std::string_view ip;
 };
 
 struct ContributorWithUsername {
-    static std::vector<ContributorWithUsername> read() {
+    // The usernames point into the file
+    static std::vector<ContributorWithUsername> read(const MappedFile& idFile, const MappedFile& usernameFile) {
         std::vector<ContributorWithUsername> result;
-        BinaryReader id_reader("C:\\Users\\joank\\work\\enwikxprments\\src\\extractor\\data\\contributors_with_username_id");
-        BinaryReader username_reader("C:\\Users\\joank\\work\\enwikxprments\\src\\extractor\\data\\contributors_with_username_username");
+        BinaryReader id_reader(idFile);
+        BinaryReader username_reader(usernameFile);
 
         while (id_reader.has_more()) {
             ContributorWithUsername contributor;
@@ -91,5 +95,31 @@ struct ContributorWithUsername {
         return result;
     }
     int id;
-    char* username;
+    std::string_view username;
+};
+
+// All contributor dictionaries of a data directory. The strings point into the mapped files, which are kept open for
+// as long as this object exists; it is only read after construction, so it can be shared between threads.
+struct Contributors {
+    Contributors(const std::string& directory):
+        ipAddressFile(directory + "/contributors_with_ip_address"),
+        ipRangeFile(directory + "/contributors_with_ip_range"),
+        ipStringFile(directory + "/contributors_with_ip_string"),
+        usernameIdFile(directory + "/contributors_with_username_id"),
+        usernameFile(directory + "/contributors_with_username_username") {
+        withIpAddress = ContributorWithIpAddress::read(ipAddressFile);
+        withIpRange = ContributorWithIpRange::read(ipRangeFile);
+        withIpString = ContributorWithIpString::read(ipStringFile);
+        withUsername = ContributorWithUsername::read(usernameIdFile, usernameFile);
+    }
+
+    MappedFile ipAddressFile;
+    MappedFile ipRangeFile;
+    MappedFile ipStringFile;
+    MappedFile usernameIdFile;
+    MappedFile usernameFile;
+    std::vector<ContributorWithIpAddress> withIpAddress;
+    std::vector<ContributorWithIpRange> withIpRange;
+    std::vector<ContributorWithIpString> withIpString;
+    std::vector<ContributorWithUsername> withUsername;
 };
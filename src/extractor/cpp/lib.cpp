@@ -1,14 +1,27 @@
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "article_corpus.hpp"
+#include "batch_packer.hpp"
 #include "contributor.hpp"
 #include "page_revision.hpp"
+#include "parallel_renderer.hpp"
+#include "parallel_tokenizer.hpp"
+#include "subalphabet_subword_text_encoder.hpp"
+#include "subword_text_encoder.hpp"
+#include "text_encoder.hpp"
+#include "token_writer.hpp"
+#include "verifier.hpp"
 #include "xmlwriter.hpp"
 
-int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        return 1;
-    }
-    FILE* output = fopen(argv[1], "wb");
-    XmlWriter writer(output);
+// The data directory holds the files that the Java extractor or compress --compress write
+const char* DEFAULT_DATA_DIRECTORY = "C:\\Users\\joank\\work\\enwikxprments\\src\\extractor\\data";
 
+void writeDump(XmlWriter& writer, const Contributors& contributors, const std::string& dataDirectory) {
     writer.openTag("mediawiki", {
         XmlAttribute("xmlns", "http://www.mediawiki.org/xml/export-0.3/"),
         XmlAttribute("xmlns:xsi", "http://www.w3.org/2001/XMLSchema-instance"),
@@ -22,7 +35,7 @@ int main(int argc, char *argv[]) {
     writer.writeTag("base", "http://en.wikipedia.org/wiki/Main_Page");
     writer.writeTag("generator", "MediaWiki 1.6alpha");
     writer.writeTag("case", "first-letter");
-    writer.printf("  "); // This is a special case in the enwik dataset
+    writer.write("  ", 2); // This is a special case in the enwik dataset
     writer.openTag("namespaces");
     writer.writeTag("namespace", "Media", {XmlAttribute("key", "-2")});
     writer.writeTag("namespace", "Special", {XmlAttribute("key", "-1")});
@@ -47,13 +60,173 @@ int main(int argc, char *argv[]) {
     writer.closeTag();
     writer.closeTag();
 
-    std::vector<PageRevision> pageRevisions = PageRevision::read();
-    for (const PageRevision& pageRevision : pageRevisions) {
-        writer.writePage(pageRevision);
+    PageRevisions pageRevisions(dataDirectory);
+    unsigned threadCount = std::thread::hardware_concurrency();
+    if (threadCount > 1) {
+        ParallelRenderer renderer(writer, contributors, threadCount);
+        for (const PageRevision& pageRevision : pageRevisions) {
+            renderer.writePage(pageRevision);
+        }
+        renderer.finish();
+    }
+    else {
+        for (const PageRevision& pageRevision : pageRevisions) {
+            writer.writePage(pageRevision);
+        }
     }
     writer.closeTag();
+    writer.flush();
+}
+
+// Encodes the articles with the vocabulary at <vocabularyPrefix>.subwords, and <vocabularyPrefix>.subalphabet if there
+// is one, the same way the notebooks do it
+void exportTokens(const std::string& vocabularyPrefix, const std::string& outputPrefix, const std::string& dataDirectory) {
+    std::unique_ptr<TextEncoder> encoderPointer = loadTextEncoder(vocabularyPrefix);
+    const TextEncoder& encoder = *encoderPointer;
+    if (encoder.vocabSize() > TokenWriter::MAX_VOCABULARY_SIZE) {
+        throw std::runtime_error("The vocabulary is too large for 16-bit tokens");
+    }
+
+    TokenWriter writer(outputPrefix);
+    PageRevisions pageRevisions(dataDirectory);
+    unsigned threadCount = std::thread::hardware_concurrency();
+    if (threadCount > 1) {
+        ParallelTokenizer tokenizer(writer, encoder, threadCount);
+        for (const PageRevision& pageRevision : pageRevisions) {
+            tokenizer.writeArticle(pageRevision);
+        }
+        tokenizer.finish();
+    }
+    else {
+        std::vector<int> ids;
+        for (const PageRevision& pageRevision : pageRevisions) {
+            ids.clear();
+            encodeArticle(encoder, pageRevision, ids);
+            writer.writeArticle(ids.data(), ids.size());
+        }
+    }
+    writer.close();
+}
+
+// Builds a vocabulary from the articles in the same way as build_from_corpus in Python, and writes it where
+// loadTextEncoder and the notebooks can load it. A subalphabet size of 0 builds a plain SubwordTextEncoder.
+void buildVocabulary(size_t targetVocabSize, size_t subalphabetSize, const std::string& outputPrefix, const std::string& dataDirectory) {
+    PageRevisions pageRevisions(dataDirectory);
+    ArticleCorpus corpus(pageRevisions);
+    unsigned threadCount = std::thread::hardware_concurrency();
+
+    if (subalphabetSize == 0) {
+        SubwordTextEncoder encoder = SubwordTextEncoder::buildFromCorpus(corpus, targetVocabSize, threadCount);
+        encoder.saveToFile(outputPrefix);
+        std::cout << "Built a vocabulary of " << encoder.vocabSize() << std::endl;
+    }
+    else {
+        SubalphabetSubwordTextEncoder encoder = SubalphabetSubwordTextEncoder::buildFromCorpus(corpus, subalphabetSize, targetVocabSize, threadCount);
+        encoder.saveToFile(outputPrefix);
+        std::cout << "Built a vocabulary of " << encoder.vocabSize() << std::endl;
+    }
+}
+
+// Packs the articles that --export-tokens wrote at <tokensPrefix> into the padded batches that the notebooks train on
+void packBatches(const std::string& tokensPrefix, size_t batchSize, size_t batchedItemLength, size_t epochCount, const std::string& output) {
+    BatchPacker packer(tokensPrefix, batchSize, batchedItemLength);
+    packer.write(output, epochCount);
+    std::cout << "Packed " << packer.windowCount() << " batches" << std::endl;
+}
+
+size_t parseCount(const char* argument) {
+    char* end;
+    unsigned long long count = strtoull(argument, &end, 10);
+    if (!isdigit((unsigned char) argument[0]) || *end != '\0' || count > SIZE_MAX) {
+        throw std::runtime_error("'" + std::string(argument) + "' is not a count");
+    }
+    return count;
+}
+
+// Usage: extractor <output> [<data directory>]
+//        extractor --verify <original> [<data directory>]
+//        extractor --export-tokens <vocabulary prefix> <output prefix> [<data directory>]
+//        extractor --build-vocabulary <target vocabulary size> <output prefix> [<data directory>]
+//        extractor --build-subalphabet-vocabulary <subalphabet size> <target vocabulary size> <output prefix> [<data directory>]
+//        extractor --pack-batches <tokens prefix> <batch size> <batched item length> <epoch count> <output>
+// Exits with 1 on wrong arguments, 2 when the dump differs from the original and 3 on any other error.
+int main(int argc, char *argv[])
+try {
+    if (argc > 1 && std::string(argv[1]) == "--export-tokens") {
+        if (argc != 4 && argc != 5) {
+            return 1;
+        }
 
-    fclose(output);
+        exportTokens(argv[2], argv[3], argc == 5 ? argv[4] : DEFAULT_DATA_DIRECTORY);
+        return 0;
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "--build-vocabulary") {
+        if (argc != 4 && argc != 5) {
+            return 1;
+        }
+
+        buildVocabulary(parseCount(argv[2]), 0, argv[3], argc == 5 ? argv[4] : DEFAULT_DATA_DIRECTORY);
+        return 0;
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "--build-subalphabet-vocabulary") {
+        if (argc != 5 && argc != 6) {
+            return 1;
+        }
+
+        buildVocabulary(parseCount(argv[3]), parseCount(argv[2]), argv[4], argc == 6 ? argv[5] : DEFAULT_DATA_DIRECTORY);
+        return 0;
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "--pack-batches") {
+        if (argc != 7) {
+            return 1;
+        }
+
+        packBatches(argv[2], parseCount(argv[3]), parseCount(argv[4]), parseCount(argv[5]), argv[6]);
+        return 0;
+    }
+
+    bool verify = argc > 1 && std::string(argv[1]) == "--verify";
+    int argumentCount = verify ? argc - 1 : argc;
+    if (argumentCount != 2 && argumentCount != 3) {
+        return 1;
+    }
+
+    const char* path = argv[verify ? 2 : 1];
+    std::string dataDirectory = argumentCount == 3 ? argv[argc - 1] : DEFAULT_DATA_DIRECTORY;
+    Contributors contributors(dataDirectory);
+
+    // Nothing is written when verifying; the dump is rendered and compared with the original as it goes
+    if (verify) {
+        Verifier verifier(path);
+        XmlWriter writer(verifier, contributors);
+        writeDump(writer, contributors, dataDirectory);
+        verifier.finish();
+
+        std::cout << "Verified " << verifier.size() << " bytes" << std::endl;
+        return 0;
+    }
+
+    FILE* output = fopen(path, "wb");
+    if (output == nullptr) {
+        throw std::runtime_error("Could not create '" + std::string(path) + "'");
+    }
+    XmlWriter writer(output, contributors);
+    writeDump(writer, contributors, dataDirectory);
+    if (fclose(output) != 0) {
+        throw std::runtime_error("Could not write '" + std::string(path) + "'");
+    }
 
     return 0;
 }
+catch (const VerificationError& error) {
+    std::cerr << error.what() << std::endl;
+    return 2;
+}
+// The files that could not be read or written, and the arguments that are not counts
+catch (const std::exception& error) {
+    std::cerr << "An error occurred: " << error.what() << std::endl;
+    return 3;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// A whole file mapped read-only into memory. Its pages are loaded on demand and can be dropped by the OS at any time,
+// so even the largest data files take up little more than the page cache.
+class MappedFile {
+public:
+    MappedFile(const std::string& filename) {
+        data_ = nullptr;
+        size_ = 0;
+
+#ifdef _WIN32
+        HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        LARGE_INTEGER size;
+        if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size)) {
+            throw std::runtime_error("Could not open '" + filename + "'");
+        }
+        size_ = (size_t) size.QuadPart;
+
+        if (size_ > 0) {
+            HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping != nullptr) {
+                data_ = (const char*) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                CloseHandle(mapping);
+            }
+        }
+        CloseHandle(file);
+#else
+        int file = open(filename.c_str(), O_RDONLY);
+        struct stat status;
+        if (file == -1 || fstat(file, &status) != 0) {
+            throw std::runtime_error("Could not open '" + filename + "'");
+        }
+        size_ = (size_t) status.st_size;
+
+        if (size_ > 0) {
+            void* mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file, 0);
+            if (mapping != MAP_FAILED) {
+                data_ = (const char*) mapping;
+                madvise(mapping, size_, MADV_SEQUENTIAL);
+            }
+        }
+        close(file);
+#endif
+
+        if (size_ > 0 && data_ == nullptr) {
+            throw std::runtime_error("Could not map '" + filename + "'");
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        if (data_ != nullptr) {
+#ifdef _WIN32
+            UnmapViewOfFile(data_);
+#else
+            munmap((void*) data_, size_);
+#endif
+        }
+    }
+
+    const char* data() const {
+        return data_;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+private:
+    const char* data_;
+    size_t size_;
+};
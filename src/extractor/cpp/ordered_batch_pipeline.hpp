@@ -0,0 +1,148 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "page_revision.hpp"
+
+// Processes page revisions on worker threads and writes the results in their original order. The pages are grouped in
+// batches; every worker processes a whole batch, and the batches are written, on the thread that adds the pages, in the
+// order they were added, so the output is the same as with processing every page in turn. At most two batches per
+// thread are in flight, which bounds the memory whatever the input.
+//
+// Each thread has a Worker of its own, made from the context, which can keep what it reuses from one batch to the next:
+//   typedef ... Output;
+//   Worker(const Context& context);
+//   void process(const std::vector<PageRevision>& pages, Output& output);
+template <typename Worker, typename Context>
+class OrderedBatchPipeline {
+public:
+    typedef typename Worker::Output Output;
+
+    OrderedBatchPipeline(const Context& context, std::function<void(Output&)> write, unsigned threadCount):
+        write(write),
+        maxBatchesInFlight(2 * threadCount),
+        stopping(false) {
+        currentBatch.reset(new Batch());
+
+        for (unsigned i = 0; i < threadCount; i++) {
+            workers.emplace_back(&OrderedBatchPipeline::work, this, std::ref(context));
+        }
+    }
+
+    ~OrderedBatchPipeline() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        batchAvailable.notify_all();
+
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    // The strings of the page revision have to stay valid until finish() returns. The size is how many bytes of text the
+    // page adds to its batch.
+    void add(const PageRevision& pageRevision, size_t size) {
+        currentBatch->pages.push_back(pageRevision);
+        currentBatch->size += size;
+
+        if (currentBatch->pages.size() >= MAX_BATCH_PAGES || currentBatch->size >= MAX_BATCH_SIZE) {
+            submitBatch();
+        }
+    }
+
+    // Writes everything that is still being processed
+    void finish() {
+        if (!currentBatch->pages.empty()) {
+            submitBatch();
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!batchesInFlight.empty()) {
+            writeFirstBatch(lock);
+        }
+    }
+
+private:
+    static const size_t MAX_BATCH_PAGES = 4096;
+    static const size_t MAX_BATCH_SIZE = 4 << 20;
+
+    struct Batch {
+        std::vector<PageRevision> pages;
+        size_t size = 0;
+        Output output;
+        bool processed = false;
+    };
+
+    std::function<void(Output&)> write;
+    size_t maxBatchesInFlight;
+    std::vector<std::thread> workers;
+    std::unique_ptr<Batch> currentBatch;
+
+    std::mutex mutex;
+    std::condition_variable batchAvailable;
+    std::condition_variable batchProcessed;
+    std::deque<std::unique_ptr<Batch>> batchesInFlight; // In page order
+    std::deque<Batch*> batchesToProcess;
+    bool stopping;
+
+    void submitBatch() {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        while (batchesInFlight.size() >= maxBatchesInFlight) {
+            writeFirstBatch(lock);
+        }
+
+        batchesToProcess.push_back(currentBatch.get());
+        batchesInFlight.push_back(std::move(currentBatch));
+        batchAvailable.notify_one();
+
+        currentBatch.reset(new Batch());
+    }
+
+    // The output is written without holding the lock, so that the workers can go on meanwhile
+    void writeFirstBatch(std::unique_lock<std::mutex>& lock) {
+        batchProcessed.wait(lock, [this] { return batchesInFlight.front()->processed; });
+        std::unique_ptr<Batch> batch = std::move(batchesInFlight.front());
+        batchesInFlight.pop_front();
+
+        lock.unlock();
+        write(batch->output);
+        batch.reset();
+        lock.lock();
+    }
+
+    void work(const Context& context) {
+        Worker worker(context);
+
+        while (true) {
+            Batch* batch;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                batchAvailable.wait(lock, [this] { return stopping || !batchesToProcess.empty(); });
+                if (batchesToProcess.empty()) {
+                    return;
+                }
+                batch = batchesToProcess.front();
+                batchesToProcess.pop_front();
+            }
+
+            Output output;
+            worker.process(batch->pages, output);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                batch->output = std::move(output);
+                batch->processed = true;
+            }
+            batchProcessed.notify_all();
+        }
+    }
+};
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <time.h>
-#include <vector>
+#include <iterator>
+#include <string>
+#include <string_view>
 
 #include "binary_reader.hpp"
 
@@ -18,32 +20,6 @@ enum Restrictions {
 };
 
 struct PageRevision {
-    static std::vector<PageRevision> read() {
-        std::vector<PageRevision> result;
-        BinaryReader reader("C:\\Users\\joank\\work\\enwikxprments\\src\\extractor\\data\\page_revisions");
-        BinaryReader title_reader("C:\\Users\\joank\\work\\enwikxprments\\src\\extractor\\data\\page_revisions_title");
-        BinaryReader comment_reader("C:\\Users\\joank\\work\\enwikxprments\\src\\extractor\\data\\page_revisions_comment");
-        BinaryReader text_reader("C:\\Users\\joank\\work\\enwikxprments\\src\\extractor\\data\\page_revisions_text");
-
-        while (reader.has_more()) {
-            PageRevision page_revision;
-
-            page_revision.pageTitle = title_reader.read_string();
-            page_revision.pageId = reader.read<int>();
-            page_revision.pageRestrictions = reader.read<char>();
-            page_revision.revisionId = reader.read<int>();
-            page_revision.revisionTimestamp = reader.read<time_t>();
-            page_revision.revisionContributorIndex = reader.read<int>();
-            page_revision.revisionMinor = reader.read<char>();
-            page_revision.revisionComment = comment_reader.read_string();
-            page_revision.revisionText = text_reader.read_string();
-
-            result.push_back(page_revision);
-        }
-
-        return result;
-    }
-
     const char* getPageRestrictions() const {
         switch (pageRestrictions) {
             case Restrictions::NONE: return "";
@@ -58,13 +34,112 @@ struct PageRevision {
         }
     }
 
-    char* pageTitle;
+    std::string_view pageTitle;
     int pageId;
     char pageRestrictions;
     int revisionId;
     time_t revisionTimestamp;
     int revisionContributorIndex;
     bool revisionMinor;
-    char* revisionComment;
-    char* revisionText;
+    std::string_view revisionComment;
+    std::string_view revisionText;
+};
+
+// The page revisions in a data directory, read one at a time as they are iterated over. The strings of a page revision
+// point into the mapped files, so they are only valid while this object is alive.
+class PageRevisions {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = PageRevision;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const PageRevision*;
+        using reference = const PageRevision&;
+
+        iterator(): position(nullptr), atEnd(true) {
+        }
+
+        iterator(const PageRevisions& pageRevisions):
+            reader(pageRevisions.file),
+            titleReader(pageRevisions.titleFile),
+            commentReader(pageRevisions.commentFile),
+            textReader(pageRevisions.textFile),
+            position(nullptr),
+            atEnd(false) {
+            ++*this;
+        }
+
+        reference operator*() const {
+            return pageRevision;
+        }
+
+        pointer operator->() const {
+            return &pageRevision;
+        }
+
+        iterator& operator++() {
+            if (!reader.has_more()) {
+                atEnd = true;
+                return *this;
+            }
+
+            position = reader.position();
+            pageRevision.pageTitle = titleReader.read_string();
+            pageRevision.pageId = reader.read<int>();
+            pageRevision.pageRestrictions = reader.read<char>();
+            pageRevision.revisionId = reader.read<int>();
+            pageRevision.revisionTimestamp = reader.read<long long>();
+            pageRevision.revisionContributorIndex = reader.read<int>();
+            pageRevision.revisionMinor = reader.read<char>();
+            pageRevision.revisionComment = commentReader.read_string();
+            pageRevision.revisionText = textReader.read_string();
+
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator result = *this;
+            ++*this;
+            return result;
+        }
+
+        bool operator==(const iterator& other) const {
+            return atEnd == other.atEnd && (atEnd || position == other.position);
+        }
+
+        bool operator!=(const iterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        BinaryReader reader;
+        BinaryReader titleReader;
+        BinaryReader commentReader;
+        BinaryReader textReader;
+        const char* position;
+        bool atEnd;
+        PageRevision pageRevision;
+    };
+
+    PageRevisions(const std::string& directory):
+        file(directory + "/page_revisions"),
+        titleFile(directory + "/page_revisions_title"),
+        commentFile(directory + "/page_revisions_comment"),
+        textFile(directory + "/page_revisions_text") {
+    }
+
+    iterator begin() const {
+        return iterator(*this);
+    }
+
+    iterator end() const {
+        return iterator();
+    }
+
+private:
+    MappedFile file;
+    MappedFile titleFile;
+    MappedFile commentFile;
+    MappedFile textFile;
 };
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+
+#include "contributor.hpp"
+#include "ordered_batch_pipeline.hpp"
+#include "page_revision.hpp"
+#include "xmlwriter.hpp"
+
+// Renders pages on worker threads and writes them in their original order, so the output is the same as with
+// XmlWriter::writePage alone
+class ParallelRenderer {
+public:
+    ParallelRenderer(XmlWriter& writer, const Contributors& contributors, unsigned threadCount):
+        pipeline(contributors, [&writer](std::vector<char>& output) { writer.write(output.data(), output.size()); }, threadCount) {
+    }
+
+    // The strings of the page revision have to stay valid until finish() returns
+    void writePage(const PageRevision& pageRevision) {
+        pipeline.add(pageRevision, pageRevision.pageTitle.size() + pageRevision.revisionComment.size() + pageRevision.revisionText.size());
+    }
+
+    // Writes everything that is still being rendered
+    void finish() {
+        pipeline.finish();
+    }
+
+private:
+    // Renders into an XmlWriter without an output file, whose buffer every batch of the thread reuses
+    class Renderer {
+    public:
+        typedef std::vector<char> Output;
+
+        Renderer(const Contributors& contributors): batchWriter(nullptr, contributors) {}
+
+        void process(const std::vector<PageRevision>& pages, Output& output) {
+            for (const PageRevision& pageRevision : pages) {
+                batchWriter.writePage(pageRevision);
+            }
+            output = batchWriter.takeOutput();
+        }
+
+    private:
+        XmlWriter batchWriter;
+    };
+
+    OrderedBatchPipeline<Renderer, Contributors> pipeline;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+
+#include "ordered_batch_pipeline.hpp"
+#include "page_revision.hpp"
+#include "text_encoder.hpp"
+#include "token_writer.hpp"
+
+// Encodes articles on worker threads and writes them in their original order, so the output is the same as with
+// TokenWriter::writeArticle alone
+class ParallelTokenizer {
+public:
+    ParallelTokenizer(TokenWriter& writer, const TextEncoder& encoder, unsigned threadCount):
+        pipeline(encoder, [&writer](EncodedBatch& output) { writeBatch(writer, output); }, threadCount) {
+    }
+
+    // The strings of the page revision have to stay valid until finish() returns
+    void writeArticle(const PageRevision& pageRevision) {
+        pipeline.add(pageRevision, pageRevision.pageTitle.size() + pageRevision.revisionText.size());
+    }
+
+    // Writes everything that is still being encoded
+    void finish() {
+        pipeline.finish();
+    }
+
+private:
+    // The ids of all the articles of a batch one after the other
+    struct EncodedBatch {
+        std::vector<int> ids;
+        std::vector<size_t> articleLengths;
+    };
+
+    class Encoder {
+    public:
+        typedef EncodedBatch Output;
+
+        Encoder(const TextEncoder& encoder): encoder(encoder) {}
+
+        void process(const std::vector<PageRevision>& pages, Output& output) {
+            for (const PageRevision& pageRevision : pages) {
+                size_t start = output.ids.size();
+                encodeArticle(encoder, pageRevision, output.ids);
+                output.articleLengths.push_back(output.ids.size() - start);
+            }
+        }
+
+    private:
+        const TextEncoder& encoder;
+    };
+
+    OrderedBatchPipeline<Encoder, TextEncoder> pipeline;
+
+    static void writeBatch(TokenWriter& writer, const EncodedBatch& batch) {
+        const int* ids = batch.ids.data();
+        for (size_t articleLength : batch.articleLengths) {
+            writer.writeArticle(ids, articleLength);
+            ids += articleLength;
+        }
+    }
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "article_corpus.hpp"
+#include "page_revision.hpp"
+#include "text_encoder.hpp"
+
+inline void encodeArticle(const TextEncoder& encoder, const PageRevision& pageRevision, std::vector<int>& ids) {
+    std::string article;
+    formatArticle(pageRevision, article);
+    encoder.encode(article, ids);
+}
+
+// Writes two files that can be memory-mapped as they are: <prefix>.tokens holds the int16 ids of all articles one after
+// the other, and <prefix>.offsets holds the uint64 index of the first token of every article, followed by the total
+// count, so that article i is tokens[offsets[i]:offsets[i + 1]]. The files are only complete once close() returns.
+class TokenWriter {
+public:
+    static const size_t MAX_VOCABULARY_SIZE = 1 << 15;
+
+    TokenWriter(const std::string& prefix):
+        tokensFilename(prefix + ".tokens"), offsetsFilename(prefix + ".offsets"), tokens(nullptr), offsets(nullptr), tokenCount(0) {
+        tokens = open(tokensFilename);
+        offsets = open(offsetsFilename);
+        writeOffset();
+    }
+
+    TokenWriter(const TokenWriter&) = delete;
+    TokenWriter& operator=(const TokenWriter&) = delete;
+
+    // Only closes the files that close() did not, after an error that has been thrown already
+    ~TokenWriter() {
+        if (tokens != nullptr) {
+            fclose(tokens);
+        }
+        if (offsets != nullptr) {
+            fclose(offsets);
+        }
+    }
+
+    void writeArticle(const int* ids, size_t count) {
+        buffer.assign(ids, ids + count);
+        if (fwrite(buffer.data(), sizeof(int16_t), buffer.size(), tokens) != buffer.size()) {
+            throw std::runtime_error("Could not write '" + tokensFilename + "'");
+        }
+
+        tokenCount += count;
+        writeOffset();
+    }
+
+    // Writes out what is still buffered, which is where a full disk shows up for the last articles
+    void close() {
+        bool tokensClosed = fclose(tokens) == 0;
+        bool offsetsClosed = fclose(offsets) == 0;
+        tokens = nullptr;
+        offsets = nullptr;
+
+        if (!tokensClosed) {
+            throw std::runtime_error("Could not write '" + tokensFilename + "'");
+        }
+        if (!offsetsClosed) {
+            throw std::runtime_error("Could not write '" + offsetsFilename + "'");
+        }
+    }
+
+private:
+    std::string tokensFilename;
+    std::string offsetsFilename;
+    FILE* tokens;
+    FILE* offsets;
+    uint64_t tokenCount;
+    std::vector<int16_t> buffer;
+
+    static FILE* open(const std::string& filename) {
+        FILE* result = fopen(filename.c_str(), "wb");
+        if (result == nullptr) {
+            throw std::runtime_error("Could not create '" + filename + "'");
+        }
+        setvbuf(result, nullptr, _IOFBF, 1 << 20);
+
+        return result;
+    }
+
+    void writeOffset() {
+        if (fwrite(&tokenCount, sizeof(tokenCount), 1, offsets) != 1) {
+            throw std::runtime_error("Could not write '" + offsetsFilename + "'");
+        }
+    }
+};
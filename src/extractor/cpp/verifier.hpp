@@ -0,0 +1,128 @@
+#pragma once
+
+#include <string.h>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VERIFIER_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#include "mapped_file.hpp"
+
+// Thrown at the first byte where the output differs from the original
+class VerificationError : public std::runtime_error {
+public:
+    VerificationError(size_t offset, long long pageId):
+        std::runtime_error(describe(offset, pageId)), offset(offset), pageId(pageId) {
+    }
+
+    const size_t offset;
+    const long long pageId; // -1 outside of a page
+
+private:
+    static std::string describe(size_t offset, long long pageId) {
+        std::string result = "The output differs from the original at byte " + std::to_string(offset);
+        if (pageId >= 0) {
+            result += " (page " + std::to_string(pageId) + ")";
+        }
+        return result;
+    }
+};
+
+// Compares output, as it is produced, with a mapped original file instead of writing it anywhere
+class Verifier {
+public:
+    Verifier(const std::string& originalPath): original(originalPath), offset(0) {
+    }
+
+    void compare(const char* data, size_t length) {
+        size_t available = original.size() - offset;
+        size_t mismatch = findMismatch(original.data() + offset, data, std::min(length, available));
+
+        if (mismatch < length) {
+            throw VerificationError(offset + mismatch, findPageId(offset + mismatch));
+        }
+        offset += length;
+    }
+
+    // Has to be called after the last output, in case the original is longer
+    void finish() {
+        if (offset != original.size()) {
+            throw VerificationError(offset, findPageId(offset));
+        }
+    }
+
+    size_t size() const {
+        return offset;
+    }
+
+private:
+    MappedFile original;
+    size_t offset;
+
+    // The id of the page that the offset is in, taken from the original: the first <id> after the last <page>, unless
+    // the page ends before the offset, as it does for the bytes after the last page
+    long long findPageId(size_t position) const {
+        static const std::string_view PAGE_END = "</page>";
+
+        std::string_view text(original.data(), original.size());
+        size_t pageStart = text.rfind("<page>", position);
+        if (pageStart == std::string_view::npos) {
+            return -1;
+        }
+
+        size_t pageEnd = text.find(PAGE_END, pageStart);
+        if (pageEnd != std::string_view::npos && position >= pageEnd + PAGE_END.size()) {
+            return -1;
+        }
+
+        size_t idStart = text.find("<id>", pageStart);
+        if (idStart == std::string_view::npos) {
+            return -1;
+        }
+
+        long long result = 0;
+        for (size_t i = idStart + 4; i < text.size() && text[i] >= '0' && text[i] <= '9'; i++) {
+            result = 10 * result + (text[i] - '0');
+        }
+        return result;
+    }
+
+    // Returns the index of the first byte that differs, or the length if there is none
+    static size_t findMismatch(const char* expected, const char* actual, size_t length) {
+        size_t index = 0;
+
+#ifdef VERIFIER_SSE2
+        for (; index + 16 <= length; index += 16) {
+            __m128i equal = _mm_cmpeq_epi8(
+                _mm_loadu_si128((const __m128i*) (expected + index)),
+                _mm_loadu_si128((const __m128i*) (actual + index)));
+            unsigned mask = ~(unsigned) _mm_movemask_epi8(equal) & 0xFFFF;
+
+            if (mask != 0) {
+#ifdef _MSC_VER
+                unsigned long first;
+                _BitScanForward(&first, mask);
+                return index + first;
+#else
+                return index + __builtin_ctz(mask);
+#endif
+            }
+        }
+#endif
+
+        for (; index < length; index++) {
+            if (expected[index] != actual[index]) {
+                return index;
+            }
+        }
+        return length;
+    }
+};
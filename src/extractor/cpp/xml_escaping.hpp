@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stddef.h>
+#include <string_view>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define XML_ESCAPING_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// The characters that the dump replaces by entities in its text, for XmlWriter and for compress's OutputBuffer, which
+// have to escape them the same way
+inline bool needsEscaping(char character) {
+    return character == '"' || character == '<' || character == '>' || character == '&';
+}
+
+// The entity of a character that needsEscaping
+inline std::string_view escapedEntity(char character) {
+    switch (character) {
+        case '"':
+            return "&quot;";
+        case '<':
+            return "&lt;";
+        case '>':
+            return "&gt;";
+        default:
+            return "&amp;";
+    }
+}
+
+// Returns the index of the first character that has to be escaped, or the length if there is none
+inline size_t findEscapedCharacter(const char* text, size_t length) {
+    size_t index = 0;
+
+#ifdef XML_ESCAPING_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i lessThan = _mm_set1_epi8('<');
+    const __m128i greaterThan = _mm_set1_epi8('>');
+    const __m128i ampersand = _mm_set1_epi8('&');
+
+    auto matches = [&](size_t offset) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*) (text + offset));
+        return _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, lessThan)),
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, greaterThan), _mm_cmpeq_epi8(chunk, ampersand)));
+    };
+
+    // Clean text is the common case, so 64 bytes are checked at once before looking for the exact position
+    for (; index + 64 <= length; index += 64) {
+        __m128i any = _mm_or_si128(_mm_or_si128(matches(index), matches(index + 16)), _mm_or_si128(matches(index + 32), matches(index + 48)));
+        if (_mm_movemask_epi8(any) != 0) {
+            break;
+        }
+    }
+
+    for (; index + 16 <= length; index += 16) {
+        unsigned mask = (unsigned) _mm_movemask_epi8(matches(index));
+
+        if (mask != 0) {
+#ifdef _MSC_VER
+            unsigned long first;
+            _BitScanForward(&first, mask);
+            return index + first;
+#else
+            return index + __builtin_ctz(mask);
+#endif
+        }
+    }
+#endif
+
+    for (; index < length; index++) {
+        if (needsEscaping(text[index])) {
+            return index;
+        }
+    }
+    return length;
+}
+
+// Writes the text to anything with a write(const char*, size_t), with clean runs copied as they are and only the
+// characters in between replaced by entities
+template <typename Output>
+void writeEscaped(Output& output, std::string_view text) {
+    while (!text.empty()) {
+        size_t run = findEscapedCharacter(text.data(), text.size());
+        output.write(text.data(), run);
+
+        if (run == text.size()) {
+            break;
+        }
+
+        std::string_view entity = escapedEntity(text[run]);
+        output.write(entity.data(), entity.size());
+        text.remove_prefix(run + 1);
+    }
+}
@@ -1,12 +1,20 @@
 #pragma once
 
-#include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
+#include <algorithm>
+#include <charconv>
 #include <stack>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "contributor.hpp"
 #include "page_revision.hpp"
+#include "verifier.hpp"
+#include "xml_escaping.hpp"
 
 class XmlAttribute {
 public:
@@ -29,11 +37,29 @@ private:
 
 class XmlWriter {
 public:
-    XmlWriter(FILE* output): output(output), indentation(0) {
-        contributorsWithIpAddress = ContributorWithIpAddress::read();
-        contributorsWithIpRange = ContributorWithIpRange::read();
-        contributorsWithIpString = ContributorWithIpString::read();
-        contributorsWithUsername = ContributorWithUsername::read();
+    // Without an output file everything is kept in memory until it is taken with takeOutput()
+    XmlWriter(FILE* output, const Contributors& contributors):
+        output(output),
+        indentation(0),
+        buffer(output ? BUFFER_SIZE : MEMORY_BUFFER_SIZE),
+        bufferLength(0),
+        verifier(nullptr),
+        contributors(contributors) {
+        // Everything goes through the buffer, so stdio's own would only add a copy
+        if (output) {
+            setvbuf(output, nullptr, _IONBF, 0);
+        }
+    }
+
+    // The output is compared with the original instead of being written; the first difference throws
+    // VerificationError
+    XmlWriter(Verifier& verifier, const Contributors& contributors):
+        output(nullptr),
+        indentation(0),
+        buffer(BUFFER_SIZE),
+        bufferLength(0),
+        verifier(&verifier),
+        contributors(contributors) {
     }
 
     void openTag(const char* tagName, std::initializer_list<XmlAttribute> attributes = {}) {
@@ -53,174 +79,283 @@ public:
     void writeTag(const char* tagName, int number) {
         writeIndentation();
         writeOpeningTag(tagName);
-        printf("%d", number);
+        writeInteger(number);
         writeClosingTag();
         writeNewLine();
     }
 
-    void writeTag(const char* tagName, const char* string, const std::initializer_list<XmlAttribute>& attributes = {}) {
+    void writeTag(const char* tagName, std::string_view string, const std::initializer_list<XmlAttribute>& attributes = {}) {
         writeIndentation();
-        if (*string) {
+        if (!string.empty()) {
             writeOpeningTag(tagName, attributes);
             writeTextNode(string);
             writeClosingTag();
         } else {
-            printf("<%s", tagName);
+            write("<", 1);
+            write(tagName, strlen(tagName));
             writeAttributes(attributes);
-            printf(" />", tagName);
+            write(" />", 3);
         }
         writeNewLine();
     }
 
     void writeTag(const char* tagName, time_t time) {
-        tm time_breakdown;
-        gmtime_s(&time_breakdown, &time);
         writeIndentation();
-
         writeOpeningTag(tagName);
-        printf("%d-%02d-%02dT%02d:%02d:%02dZ",
-            1900 + time_breakdown.tm_year,
-            1 + time_breakdown.tm_mon,
-            time_breakdown.tm_mday,
-            time_breakdown.tm_hour,
-            time_breakdown.tm_min,
-            time_breakdown.tm_sec);
-
+        writeTimestamp(time);
         writeClosingTag();
         writeNewLine();
     }
 
-    void writeTextNode(const char* text) {
-        while (*text) {
-            switch (*text) {
-                case '"':
-                    fputs("&quot;", output);
-                    break;
-                case '<':
-                    fputs("&lt;", output);
-                    break;
-                case '>':
-                    fputs("&gt;", output);
-                    break;
-                case '&':
-                    fputs("&amp;", output);
-                    break;
-                default:
-                    fputc(*text, output);
-                    break;
-            }
-
-            ++text;
-        }
+    void writeTextNode(std::string_view text) {
+        writeEscaped(*this, text);
     }
 
+    // Pages are always written inside <mediawiki>, so their tags are written from fragments that already include the
+    // indentation instead of going through the tag stack
     void writePage(const PageRevision& pageRevision) {
-        openTag("page");
-        writeTag("title", pageRevision.pageTitle);
-        writeTag("id", pageRevision.pageId);
+        writeLiteral("  <page>\n");
+        writeElement("    <title", pageRevision.pageTitle, "</title>\n");
+        writeLiteral("    <id>");
+        writeInteger(pageRevision.pageId);
+        writeLiteral("</id>\n");
 
         if (pageRevision.pageRestrictions) {
-            writeTag("restrictions", pageRevision.getPageRestrictions());
+            writeElement("    <restrictions", pageRevision.getPageRestrictions(), "</restrictions>\n");
         }
 
         writeRevision(pageRevision);
 
-        closeTag();
+        writeLiteral("  </page>\n");
     }
 
     void writeRevision(const PageRevision& pageRevision) {
-        openTag("revision");
-        writeTag("id", pageRevision.revisionId);
-        writeTag("timestamp", pageRevision.revisionTimestamp);
+        writeLiteral("    <revision>\n      <id>");
+        writeInteger(pageRevision.revisionId);
+        writeLiteral("</id>\n      <timestamp>");
+        writeTimestamp(pageRevision.revisionTimestamp);
+        writeLiteral("</timestamp>\n");
         writeContributor(pageRevision.revisionContributorIndex);
         if (pageRevision.revisionMinor) {
-            writeTag("minor", "");
+            writeLiteral("      <minor />\n");
         }
-        if (*pageRevision.revisionComment) {
-            writeTag("comment", pageRevision.revisionComment);
+        if (!pageRevision.revisionComment.empty()) {
+            writeElement("      <comment", pageRevision.revisionComment, "</comment>\n");
         }
 
-        writeTag("text", pageRevision.revisionText, {XmlAttribute("xml:space", "preserve")});
-        closeTag();
+        writeElement("      <text xml:space=\"preserve\"", pageRevision.revisionText, "</text>\n");
+        writeLiteral("    </revision>\n");
     }
 
     void writeContributor(int contributorIndex) {
         int type = contributorIndex & 3;
         int index = contributorIndex >> 2;
 
-        openTag("contributor");
+        writeLiteral("      <contributor>\n");
 
         if (type == ContributorType::IP_ADDRESS) {
-            writeIndentation();
-            writeOpeningTag("ip");
-            unsigned char* ip_bytes = contributorsWithIpAddress[index].ip_bytes;
-            printf("%d.%d.%d.%d", ip_bytes[0], ip_bytes[1], ip_bytes[2], ip_bytes[3]);
-            writeClosingTag();
-            writeNewLine();
+            writeIp(contributors.withIpAddress[index].ip_bytes, 4, "</ip>\n");
         }
         else if (type == ContributorType::IP_RANGE) {
-            writeIndentation();
-            writeOpeningTag("ip");
-            unsigned char* ip_bytes = contributorsWithIpRange[index].ip_bytes;
-            printf("%d.%d.%d.xxx", ip_bytes[0], ip_bytes[1], ip_bytes[2]);
-            writeClosingTag();
-            writeNewLine();
+            writeIp(contributors.withIpRange[index].ip_bytes, 3, ".xxx</ip>\n");
         }
         else if (type == ContributorType::IP_STRING) {
-            writeTag("ip", contributorsWithIpString[index].ip);
+            writeElement("        <ip", contributors.withIpString[index].ip, "</ip>\n");
         }
         else { // Username
-            ContributorWithUsername contributor = contributorsWithUsername[index];
-            if (contributor.username) {
-                writeTag("username", contributor.username);
-            }
+            const ContributorWithUsername& contributor = contributors.withUsername[index];
+            writeElement("        <username", contributor.username, "</username>\n");
             if (contributor.id) {
-                writeTag("id", contributor.id);
+                writeLiteral("        <id>");
+                writeInteger(contributor.id);
+                writeLiteral("</id>\n");
             }
         }
 
-        closeTag();
+        writeLiteral("      </contributor>\n");
     }
 
-    int printf(const char* format, ...) {
-        va_list arglist;
-        va_start(arglist, format);
-        int result = vfprintf(output, format, arglist);
-        va_end(arglist);
+    void write(const char* data, size_t length) {
+        if (length > buffer.size() - bufferLength) {
+            if (!output && !verifier) {
+                buffer.resize(std::max(2 * buffer.size(), bufferLength + length));
+            }
+            else {
+                flush();
+
+                if (length >= buffer.size()) {
+                    writeOutput(data, length);
+                    return;
+                }
+            }
+        }
+
+        memcpy(buffer.data() + bufferLength, data, length);
+        bufferLength += length;
+    }
+
+    // Returns everything written so far and starts over; only for a writer without an output file
+    std::vector<char> takeOutput() {
+        std::vector<char> result(MEMORY_BUFFER_SIZE);
+        result.swap(buffer);
+        result.resize(bufferLength);
+        bufferLength = 0;
         return result;
     }
+
+    // Has to be called before the output is closed, as nothing is written when the writer is destroyed
+    void flush() {
+        if ((output || verifier) && bufferLength > 0) {
+            size_t length = bufferLength;
+            bufferLength = 0;
+            writeOutput(buffer.data(), length);
+        }
+    }
 private:
+    static const size_t BUFFER_SIZE = 1 << 24;
+    static const size_t MEMORY_BUFFER_SIZE = 1 << 20;
+
     FILE* output;
     int indentation;
+    std::vector<char> buffer;
+    size_t bufferLength;
+    Verifier* verifier;
     std::stack<const char*> tags;
-    std::vector<ContributorWithIpAddress> contributorsWithIpAddress;
-    std::vector<ContributorWithIpRange> contributorsWithIpRange;
-    std::vector<ContributorWithIpString> contributorsWithIpString;
-    std::vector<ContributorWithUsername> contributorsWithUsername;
+    const Contributors& contributors;
+
+    void writeOutput(const char* data, size_t length) {
+        if (verifier) {
+            verifier->compare(data, length);
+        }
+        else if (fwrite(data, 1, length, output) != length) {
+            throw std::runtime_error("Could not write the dump");
+        }
+    }
 
     void writeOpeningTag(const char* tagName, const std::initializer_list<XmlAttribute>& attributes = {}) {
         tags.push(tagName);
-        printf("<%s", tagName);
+        write("<", 1);
+        write(tagName, strlen(tagName));
         writeAttributes(attributes);
-        printf(">", tagName);
+        write(">", 1);
     }
 
     void writeAttributes(const std::initializer_list<XmlAttribute>& attributes = {}) {
         for (auto& attribute : attributes) {
-            printf(" %s=\"%s\"", attribute.getName(), attribute.getValue());
+            write(" ", 1);
+            write(attribute.getName(), strlen(attribute.getName()));
+            write("=\"", 2);
+            write(attribute.getValue(), strlen(attribute.getValue()));
+            write("\"", 1);
         }
     }
 
     void writeClosingTag() {
-        printf("</%s>", tags.top());
+        write("</", 2);
+        write(tags.top(), strlen(tags.top()));
+        write(">", 1);
         tags.pop();
     }
 
     void writeIndentation() {
-        printf("%*s", indentation, "");
+        static const char SPACES[] = "                                ";
+
+        for (int remaining = indentation; remaining > 0; remaining -= sizeof(SPACES) - 1) {
+            write(SPACES, std::min<size_t>(remaining, sizeof(SPACES) - 1));
+        }
     }
 
     void writeNewLine() {
-        printf("\n");
+        write("\n", 1);
+    }
+
+    template <size_t N>
+    void writeLiteral(const char (&literal)[N]) {
+        write(literal, N - 1);
+    }
+
+    // The opening tag is everything up to the '>', so that an empty element can be written as <tag />
+    void writeElement(std::string_view openingTag, std::string_view text, std::string_view closingTag) {
+        write(openingTag.data(), openingTag.size());
+        if (text.empty()) {
+            writeLiteral(" />\n");
+        }
+        else {
+            write(">", 1);
+            writeTextNode(text);
+            write(closingTag.data(), closingTag.size());
+        }
+    }
+
+    void writeInteger(long long number) {
+        char digits[20];
+        char* end = std::to_chars(digits, digits + sizeof(digits), number).ptr;
+        write(digits, end - digits);
+    }
+
+    // The bytes are looked up in a table of their decimal forms and the whole element is assembled before it is written
+    void writeIp(const unsigned char* bytes, int count, std::string_view closingTag) {
+        struct DecimalByte {
+            char text[3];
+            unsigned char length;
+        };
+
+        static const std::vector<DecimalByte> DECIMAL_BYTES = [] {
+            std::vector<DecimalByte> result(256);
+            for (int byte = 0; byte < 256; byte++) {
+                result[byte].length = (unsigned char) (std::to_chars(result[byte].text, result[byte].text + 3, byte).ptr - result[byte].text);
+            }
+            return result;
+        }();
+
+        static const char OPENING_TAG[] = "        <ip>";
+        char text[64];
+        size_t length = sizeof(OPENING_TAG) - 1;
+        memcpy(text, OPENING_TAG, length);
+
+        for (int i = 0; i < count; i++) {
+            if (i > 0) {
+                text[length++] = '.';
+            }
+            const DecimalByte& decimal = DECIMAL_BYTES[bytes[i]];
+            memcpy(text + length, decimal.text, 3);
+            length += decimal.length;
+        }
+
+        memcpy(text + length, closingTag.data(), closingTag.size());
+        write(text, length + closingTag.size());
+    }
+
+    // Formats the time as YYYY-MM-DDTHH:MM:SSZ in UTC. The date is computed from the day count directly, which is
+    // exact for the years 1000 to 9999 and does not depend on the C runtime.
+    void writeTimestamp(time_t time) {
+        long long seconds = (long long) time;
+        long long days = seconds / 86400;
+        long long secondOfDay = seconds % 86400;
+        if (secondOfDay < 0) {
+            secondOfDay += 86400;
+            days--;
+        }
+
+        // Days since 1970-01-01 to a civil date, counting in 400 year eras that start on 0000-03-01
+        days += 719468;
+        long long era = (days >= 0 ? days : days - 146096) / 146097;
+        long long dayOfEra = days - era * 146097;
+        long long yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+        long long dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+        long long monthIndex = (5 * dayOfYear + 2) / 153;
+        int day = (int) (dayOfYear - (153 * monthIndex + 2) / 5 + 1);
+        int month = (int) (monthIndex < 10 ? monthIndex + 3 : monthIndex - 9);
+        int year = (int) (yearOfEra + era * 400 + (month <= 2 ? 1 : 0));
+
+        char text[] = "0000-00-00T00:00:00Z";
+        const int fields[] = { year / 100, year % 100, month, day, (int) (secondOfDay / 3600), (int) (secondOfDay / 60 % 60), (int) (secondOfDay % 60) };
+        const int offsets[] = { 0, 2, 5, 8, 11, 14, 17 };
+        for (int i = 0; i < 7; i++) {
+            text[offsets[i]] = (char) ('0' + fields[i] / 10);
+            text[offsets[i] + 1] = (char) ('0' + fields[i] % 10);
+        }
+
+        write(text, sizeof(text) - 1);
     }
 };
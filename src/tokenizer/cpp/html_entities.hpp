@@ -0,0 +1,7 @@
+#pragma once
+
+#include <string_view>
+
+// Looks up an entity of html.entities.html5 by its name without the semicolon. Only the names in lowercase are known,
+// since the text is always lowercased before the entities are replaced.
+bool findHtmlEntity(std::string_view name, std::string_view& value);
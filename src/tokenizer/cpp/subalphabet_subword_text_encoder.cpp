@@ -0,0 +1,400 @@
+#include "subalphabet_subword_text_encoder.hpp"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include "html_entities.hpp"
+#include "unicode.hpp"
+#include "vocabulary_builder.hpp"
+
+namespace {
+    bool isAsciiLetter(char character) {
+        return (character >= 'a' && character <= 'z') || (character >= 'A' && character <= 'Z');
+    }
+
+    bool isAsciiDigit(char character) {
+        return character >= '0' && character <= '9';
+    }
+
+    // One "&name;" or "&#number;" of a match; every one after the first starts with '&' only if the one before ended
+    // with an extra '&'
+    struct EscapedSymbol {
+        std::string_view text; // Including the '&', if any, and the semicolon
+        std::string_view code; // Without the '&' and the semicolon
+    };
+
+    // Matches re.compile('&(((#\d+)|([A-Za-z]+));&?)+') at the position and returns its length, or 0 if it does not
+    // match. The \d of Python matches other decimal digits as well, but they never occur in entities.
+    size_t matchEscapedSymbols(std::string_view text, size_t position, std::vector<EscapedSymbol>& symbols) {
+        symbols.clear();
+        size_t symbolStart = position;
+        size_t current = position + 1;
+        size_t matchEnd = position;
+
+        while (current < text.size()) {
+            size_t codeStart = current;
+            if (text[current] == '#') {
+                current++;
+                while (current < text.size() && isAsciiDigit(text[current])) {
+                    current++;
+                }
+                if (current == codeStart + 1) {
+                    break;
+                }
+            }
+            else {
+                while (current < text.size() && isAsciiLetter(text[current])) {
+                    current++;
+                }
+                if (current == codeStart) {
+                    break;
+                }
+            }
+
+            if (current == text.size() || text[current] != ';') {
+                break;
+            }
+            current++;
+            symbols.push_back(EscapedSymbol{
+                text.substr(symbolStart, current - symbolStart),
+                text.substr(codeStart, current - 1 - codeStart),
+            });
+
+            symbolStart = current;
+            if (current < text.size() && text[current] == '&') {
+                current++;
+            }
+            matchEnd = current;
+        }
+
+        return matchEnd - position;
+    }
+
+    // Python fails on the numbers that chr() does not accept, so they are left as they are
+    bool parseCharacterReference(std::string_view digits, char32_t& character) {
+        char32_t result = 0;
+        for (char digit : digits) {
+            result = 10 * result + (digit - '0');
+            if (result > 0x10FFFF) {
+                return false;
+            }
+        }
+
+        character = result;
+        return true;
+    }
+
+    bool isSurrogate(char32_t character) {
+        return character >= 0xD800 && character <= 0xDFFF;
+    }
+
+    // Follows _unescape_string. The match is split at the semicolons, so the '&' that may end it is dropped.
+    void appendUnescaped(std::string& result, std::string_view text) {
+        std::vector<EscapedSymbol> symbols;
+
+        for (size_t position = 0; position < text.size();) {
+            size_t ampersand = text.find('&', position);
+            if (ampersand == std::string_view::npos) {
+                result += text.substr(position);
+                break;
+            }
+            result += text.substr(position, ampersand - position);
+
+            size_t length = matchEscapedSymbols(text, ampersand, symbols);
+            if (length == 0) {
+                result += '&';
+                position = ampersand + 1;
+                continue;
+            }
+
+            for (const EscapedSymbol& symbol : symbols) {
+                std::string_view value;
+                char32_t character;
+
+                if (symbol.code[0] == '#' && parseCharacterReference(symbol.code.substr(1), character)) {
+                    // A surrogate has no UTF-8 form and is never in the subalphabet, so it is compacted in the same
+                    // way as the special character
+                    if (isSurrogate(character)) {
+                        result += (char) SubalphabetSubwordTextEncoder::SPECIAL_CHARACTER;
+                    }
+                    else {
+                        appendCharacter(result, character);
+                    }
+                }
+                else if (symbol.code[0] != '#' && findHtmlEntity(symbol.code, value)) {
+                    result += value;
+                }
+                else {
+                    result += symbol.text;
+                }
+            }
+            position = ampersand + length;
+        }
+    }
+
+    // The text as the characters of the subalphabet are counted in, before it is compacted
+    std::string simplify(std::string_view text) {
+        std::string lowercase;
+        lowercase.reserve(text.size());
+        appendLowercase(lowercase, text);
+
+        std::string result;
+        result.reserve(lowercase.size());
+        appendUnescaped(result, lowercase);
+        return result;
+    }
+
+    bool isCompleteCharacter(const std::string& bytes) {
+        size_t position = 0;
+        char32_t character = decodeCharacter(bytes, position);
+        return position == bytes.size() && (bytes.size() > 1 || character < 0x80);
+    }
+
+    // Python sorts the characters by count in a stable way, so the ones with the same count stay in the order in which
+    // they were first seen
+    struct CharacterCount {
+        int64_t count = 0;
+        std::pair<size_t, size_t> firstSeen; // The index of the text and the position in it
+    };
+
+    using CharacterCounts = std::unordered_map<char32_t, CharacterCount>;
+
+    void addCount(CharacterCounts& counts, char32_t character, const CharacterCount& count) {
+        CharacterCount& total = counts[character];
+        total.firstSeen = total.count == 0 ? count.firstSeen : std::min(total.firstSeen, count.firstSeen);
+        total.count += count.count;
+    }
+
+    // Every thread counts the ASCII characters on their own, as they are most of the text. The threads take the texts
+    // in increasing order, so the first time a thread sees a character is also the earliest.
+    CharacterCounts countCharacters(const TextCorpus& corpus, unsigned threadCount) {
+        std::vector<CharacterCounts> threadCounts(threadCount);
+        std::vector<std::vector<CharacterCount>> threadAsciiCounts(threadCount, std::vector<CharacterCount>(0x80));
+        std::vector<std::string> texts(threadCount);
+
+        parallelFor(threadCount, corpus.size(), 16, [&](unsigned thread, size_t begin, size_t end) {
+            CharacterCounts& counts = threadCounts[thread];
+            std::vector<CharacterCount>& asciiCounts = threadAsciiCounts[thread];
+
+            for (size_t i = begin; i < end; i++) {
+                corpus.getText(i, texts[thread]);
+                std::string text = simplify(texts[thread]);
+
+                for (size_t position = 0; position < text.size();) {
+                    size_t characterStart = position;
+                    char32_t character = decodeCharacter(text, position);
+                    CharacterCount& count = character < 0x80 ? asciiCounts[character] : counts[character];
+                    if (count.count++ == 0) {
+                        count.firstSeen = std::make_pair(i, characterStart);
+                    }
+                }
+            }
+        });
+
+        CharacterCounts result;
+        for (unsigned thread = 0; thread < threadCount; thread++) {
+            for (char32_t character = 0; character < 0x80; character++) {
+                if (threadAsciiCounts[thread][character].count > 0) {
+                    addCount(result, character, threadAsciiCounts[thread][character]);
+                }
+            }
+            for (const auto& count : threadCounts[thread]) {
+                addCount(result, count.first, count.second);
+            }
+        }
+        return result;
+    }
+
+    // The texts of a corpus as the subwords of an encoder see them
+    class PreprocessedCorpus : public TextCorpus {
+    public:
+        PreprocessedCorpus(const TextCorpus& corpus, const SubalphabetSubwordTextEncoder& encoder):
+            corpus(corpus),
+            encoder(encoder) {
+        }
+
+        size_t size() const override {
+            return corpus.size();
+        }
+
+        void getText(size_t index, std::string& text) const override {
+            corpus.getText(index, text);
+            text = encoder.preprocess(text);
+        }
+
+    private:
+        const TextCorpus& corpus;
+        const SubalphabetSubwordTextEncoder& encoder;
+    };
+}
+
+SubalphabetSubwordTextEncoder::SubalphabetSubwordTextEncoder(std::vector<char32_t> subalphabet, SubwordTextEncoder subwordTextEncoder):
+    subwordTextEncoder(std::move(subwordTextEncoder)),
+    subalphabet(std::move(subalphabet)),
+    asciiCodes(0x80, -1) {
+    for (size_t i = 0; i < this->subalphabet.size(); i++) {
+        char32_t character = this->subalphabet[i];
+        codes[character] = (int) i;
+        if (character < 0x80) {
+            asciiCodes[character] = (int) i;
+        }
+    }
+}
+
+SubalphabetSubwordTextEncoder SubalphabetSubwordTextEncoder::loadFromFile(const std::string& filenamePrefix) {
+    std::string filename = filenamePrefix + ".subalphabet";
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (file == nullptr) {
+        throw std::runtime_error("Could not open '" + filename + "'");
+    }
+
+    std::string content;
+    char buffer[4096];
+    for (size_t size; (size = fread(buffer, 1, sizeof(buffer), file)) > 0;) {
+        content.append(buffer, size);
+    }
+    fclose(file);
+
+    std::vector<char32_t> subalphabet = {'\0', SPECIAL_CHARACTER};
+    for (size_t position = 0; position <= content.size();) {
+        size_t end = std::min(content.find('\0', position), content.size());
+        std::string_view character(content.data() + position, end - position);
+
+        size_t characterEnd = 0;
+        if (!character.empty()) {
+            subalphabet.push_back(decodeCharacter(character, characterEnd));
+        }
+        if (characterEnd == 0 || characterEnd != character.size()) {
+            throw std::runtime_error("'" + filename + "' has to list single characters");
+        }
+        position = end + 1;
+    }
+
+    return SubalphabetSubwordTextEncoder(std::move(subalphabet), SubwordTextEncoder::loadFromFile(filenamePrefix));
+}
+
+SubalphabetSubwordTextEncoder SubalphabetSubwordTextEncoder::buildFromCorpus(const TextCorpus& corpus, size_t subalphabetSize, size_t targetVocabSize, unsigned threadCount) {
+    if (subalphabetSize < 2 || subalphabetSize > targetVocabSize + 256) {
+        throw std::runtime_error("The subalphabet has to have at least 2 characters and fit in the vocabulary");
+    }
+    threadCount = std::max(threadCount, 1u);
+
+    CharacterCounts characterCounts = countCharacters(corpus, threadCount);
+    std::vector<std::pair<char32_t, CharacterCount>> sortedCounts(characterCounts.begin(), characterCounts.end());
+    std::sort(sortedCounts.begin(), sortedCounts.end(), [](const auto& left, const auto& right) {
+        if (left.second.count != right.second.count) {
+            return left.second.count > right.second.count;
+        }
+        return left.second.firstSeen < right.second.firstSeen;
+    });
+
+    // The most common characters are last. As in _ensure_special_character_presence, '\0' makes room for the special
+    // character if it is among them, and the least common one does otherwise.
+    std::vector<char32_t> characters;
+    for (size_t i = 0; i < sortedCounts.size() && i < subalphabetSize - 1; i++) {
+        characters.push_back(sortedCounts[i].first);
+    }
+    std::reverse(characters.begin(), characters.end());
+    if (std::find(characters.begin(), characters.end(), '\0') != characters.end()) {
+        characters.erase(std::remove(characters.begin(), characters.end(), '\0'), characters.end());
+    }
+    else if (!characters.empty()) {
+        characters.erase(characters.begin());
+    }
+
+    std::vector<char32_t> subalphabet = {'\0', SPECIAL_CHARACTER};
+    subalphabet.insert(subalphabet.end(), characters.begin(), characters.end());
+
+    SubalphabetSubwordTextEncoder preprocessor(subalphabet, SubwordTextEncoder(std::vector<std::string>()));
+    PreprocessedCorpus preprocessedCorpus(corpus, preprocessor);
+    SubwordTextEncoder subwordTextEncoder = SubwordTextEncoder::buildFromCorpus(preprocessedCorpus, targetVocabSize + 256 - subalphabetSize, threadCount);
+
+    return SubalphabetSubwordTextEncoder(std::move(subalphabet), std::move(subwordTextEncoder));
+}
+
+void SubalphabetSubwordTextEncoder::saveToFile(const std::string& filenamePrefix) const {
+    subwordTextEncoder.saveToFile(filenamePrefix);
+
+    std::string filename = filenamePrefix + ".subalphabet";
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (file == nullptr) {
+        throw std::runtime_error("Could not create '" + filename + "'");
+    }
+
+    std::string content;
+    for (size_t i = 2; i < subalphabet.size(); i++) {
+        if (i > 2) {
+            content += '\0';
+        }
+        appendCharacter(content, subalphabet[i]);
+    }
+    fwrite(content.data(), 1, content.size(), file);
+
+    bool written = ferror(file) == 0;
+    if (fclose(file) != 0 || !written) {
+        throw std::runtime_error("Could not write '" + filename + "'");
+    }
+}
+
+// The subwords encode the characters that they do not match as UTF-8 bytes. The bytes are collected until they make up
+// a character, which is then encoded by its index in the subalphabet.
+void SubalphabetSubwordTextEncoder::encode(std::string_view text, std::vector<int>& ids) const {
+    std::vector<int> subwordIds;
+    subwordTextEncoder.encode(preprocess(text), subwordIds);
+
+    int subwordCount = (int) subwordTextEncoder.subwordCount();
+    std::string characterBytes;
+    for (int id : subwordIds) {
+        if (id <= subwordCount) {
+            ids.push_back(id);
+            continue;
+        }
+
+        characterBytes += (char) (id - subwordCount - 1);
+        if (isCompleteCharacter(characterBytes)) {
+            size_t position = 0;
+            ids.push_back(subwordCount + findCode(decodeCharacter(characterBytes, position)) + 1);
+            characterBytes.clear();
+        }
+    }
+}
+
+std::string SubalphabetSubwordTextEncoder::preprocess(std::string_view text) const {
+    std::string unescaped = simplify(text);
+
+    std::string result;
+    result.reserve(unescaped.size());
+    compact(result, unescaped);
+    return result;
+}
+
+// Only the first character of a text can be outside of the subalphabet, since Python does not compact it; Python fails
+// to encode it, and here it is encoded as the special character
+int SubalphabetSubwordTextEncoder::findCode(char32_t character) const {
+    if (character < 0x80) {
+        int code = asciiCodes[character];
+        return code >= 0 ? code : asciiCodes[SPECIAL_CHARACTER];
+    }
+
+    auto code = codes.find(character);
+    return code != codes.end() ? code->second : asciiCodes[SPECIAL_CHARACTER];
+}
+
+// Follows _compact_string, which keeps the first character as it is
+void SubalphabetSubwordTextEncoder::compact(std::string& result, std::string_view text) const {
+    for (size_t position = 0; position < text.size();) {
+        size_t characterStart = position;
+        char32_t character = decodeCharacter(text, position);
+
+        bool inSubalphabet = character < 0x80 ? asciiCodes[character] >= 0 : codes.count(character) > 0;
+        if (characterStart == 0 || (inSubalphabet && character != SPECIAL_CHARACTER)) {
+            result += text.substr(characterStart, position - characterStart);
+        }
+        else if (result.empty() || result.back() != SPECIAL_CHARACTER) {
+            result += (char) SPECIAL_CHARACTER;
+        }
+    }
+}
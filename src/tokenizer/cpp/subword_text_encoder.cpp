@@ -0,0 +1,228 @@
+#include "subword_text_encoder.hpp"
+
+#include <stdio.h>
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+
+#include "unicode.hpp"
+#include "vocabulary_builder.hpp"
+
+namespace {
+    const char* HEADER_LINE = "### SubwordTextEncoder";
+    const char* METADATA_LINE = "### Metadata: {}";
+
+    bool isMixedAlphanumeric(std::string_view token) {
+        bool hasWordCharacter = false;
+        bool hasOtherCharacter = false;
+
+        for (size_t position = 0; position < token.size();) {
+            if (isWordCharacter(decodeCharacter(token, position))) {
+                hasWordCharacter = true;
+            }
+            else {
+                hasOtherCharacter = true;
+            }
+        }
+        return hasWordCharacter && hasOtherCharacter;
+    }
+
+    // The start of the last character, as Python's [:-1] on a str removes a character rather than a byte
+    size_t lastCharacterStart(std::string_view text) {
+        size_t result = text.size() - 1;
+        while (result > 0 && (text[result] & 0xC0) == 0x80) {
+            result--;
+        }
+        return result;
+    }
+}
+
+SubwordTextEncoder::SubwordTextEncoder(std::vector<std::string> subwords) {
+    subwords.erase(std::remove(subwords.begin(), subwords.end(), std::string()), subwords.end());
+    this->subwords = std::move(subwords);
+
+    // As in a Python dict, a repeated subword gets the last of its ids. The replacement always stands for the byte '_'.
+    std::map<std::string, int> subwordIds;
+    std::map<std::string, int> reservedTokens;
+    for (size_t i = 0; i < this->subwords.size(); i++) {
+        subwordIds[this->subwords[i]] = (int) i;
+
+        if (isMixedAlphanumeric(this->subwords[i])) {
+            reservedTokens[this->subwords[i]] = 0;
+        }
+    }
+    subwordIds[std::string(UNDERSCORE_REPLACEMENT)] = (int) this->subwords.size() + '_';
+    reservedTokens[std::string(UNDERSCORE_REPLACEMENT)] = 0;
+
+    subwordTrie = DoubleArrayTrie(std::vector<std::pair<std::string, int>>(subwordIds.begin(), subwordIds.end()));
+    reservedTokenTrie = DoubleArrayTrie(std::vector<std::pair<std::string, int>>(reservedTokens.begin(), reservedTokens.end()));
+
+    for (int byte = 0; byte < 256; byte++) {
+        byteClasses[byte] = byte >= 0x80 ? NON_ASCII_BYTE : isWordCharacter(byte) ? WORD_BYTE : OTHER_BYTE;
+        if (reservedTokenTrie.hasKeyStartingWith(byte)) {
+            byteClasses[byte] |= RESERVED_TOKEN_START;
+        }
+    }
+}
+
+// Reads the file the way Python does: every line loses its last character (the line feed) and then its quotes. A
+// subword with a line feed in it ends up split over several lines, and Python drops or garbles it; so does this.
+SubwordTextEncoder SubwordTextEncoder::loadFromFile(const std::string& filenamePrefix) {
+    std::string filename = filenamePrefix + ".subwords";
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (file == nullptr) {
+        throw std::runtime_error("Could not open '" + filename + "'");
+    }
+
+    std::string content;
+    char buffer[1 << 16];
+    for (size_t size; (size = fread(buffer, 1, sizeof(buffer), file)) > 0;) {
+        content.append(buffer, size);
+    }
+    fclose(file);
+
+    std::vector<std::string_view> lines;
+    for (size_t lineStart = 0; lineStart < content.size();) {
+        size_t lineEnd = std::min(content.find('\n', lineStart), content.size() - 1) + 1;
+        std::string_view line(content.data() + lineStart, lineEnd - lineStart);
+        lines.push_back(line.substr(0, lastCharacterStart(line)));
+        lineStart = lineEnd;
+    }
+
+    if (lines.size() < 2 || lines[0] != HEADER_LINE) {
+        throw std::runtime_error("'" + filename + "' is not a SubwordTextEncoder vocabulary");
+    }
+
+    std::vector<std::string> subwords;
+    for (size_t i = 2; i < lines.size(); i++) {
+        size_t start = 0;
+        if (!lines[i].empty()) {
+            decodeCharacter(lines[i], start);
+        }
+        size_t end = lines[i].empty() ? 0 : lastCharacterStart(lines[i]);
+        subwords.emplace_back(start < end ? lines[i].substr(start, end - start) : "");
+    }
+    return SubwordTextEncoder(std::move(subwords));
+}
+
+SubwordTextEncoder SubwordTextEncoder::buildFromCorpus(const TextCorpus& corpus, size_t targetVocabSize, unsigned threadCount) {
+    return SubwordTextEncoder(buildSubwords(corpus, targetVocabSize, threadCount));
+}
+
+void SubwordTextEncoder::saveToFile(const std::string& filenamePrefix) const {
+    std::string filename = filenamePrefix + ".subwords";
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (file == nullptr) {
+        throw std::runtime_error("Could not create '" + filename + "'");
+    }
+
+    fprintf(file, "%s\n%s\n", HEADER_LINE, METADATA_LINE);
+    for (const std::string& subword : subwords) {
+        fputc('\'', file);
+        fwrite(subword.data(), 1, subword.size(), file);
+        fputs("'\n", file);
+    }
+
+    // A failed write shows up in the error flag, or in the flush of fclose for what is still buffered
+    bool written = ferror(file) == 0;
+    if (fclose(file) != 0 || !written) {
+        throw std::runtime_error("Could not write '" + filename + "'");
+    }
+}
+
+void SubwordTextEncoder::encode(std::string_view text, std::vector<int>& ids) const {
+    forEachToken(text, [this, &ids](std::string_view token) {
+        forEachSubword(token, [this, &ids](std::string_view subword, int subwordId) {
+            if (subwordId >= 0) {
+                ids.push_back(subwordId + 1);
+            }
+            else {
+                encodeBytes(subword, ids);
+            }
+        });
+    });
+}
+
+// Returns the end of the token that starts at the position. The tokens are the runs of word and non-word characters,
+// like re.split(r'(\W+)') without the empty strings, except for the reserved tokens, which Python splits out first. It
+// does that with a regular expression that tries them in the order of a set, so when two of them start at the same
+// place the result depends on the hash seed; the longest one is taken here.
+size_t SubwordTextEncoder::findTokenEnd(std::string_view text, size_t position) const {
+    if (position == text.size()) {
+        return position;
+    }
+
+    size_t reservedLength = findReservedToken(text, position);
+    if (reservedLength > 0) {
+        return position + reservedLength;
+    }
+
+    bool inWord = isWordCharacter(decodeCharacter(text, position));
+    unsigned char runClass = inWord ? WORD_BYTE : OTHER_BYTE;
+
+    // Most of the bytes continue the run; only the rest is looked at more closely
+    while (position < text.size()) {
+        unsigned char byteClass = byteClasses[(unsigned char) text[position]];
+        if (byteClass == runClass) {
+            position++;
+            continue;
+        }
+
+        if ((byteClass & RESERVED_TOKEN_START) != 0) {
+            if (findReservedToken(text, position) > 0) {
+                break;
+            }
+            byteClass &= ~RESERVED_TOKEN_START;
+            if (byteClass == runClass) {
+                position++;
+                continue;
+            }
+        }
+
+        size_t next = position;
+        if (byteClass != NON_ASCII_BYTE || isWordCharacter(decodeCharacter(text, next)) != inWord) {
+            break;
+        }
+        position = next;
+    }
+    return position;
+}
+
+size_t SubwordTextEncoder::findReservedToken(std::string_view text, size_t position) const {
+    int value;
+    if ((byteClasses[(unsigned char) text[position]] & RESERVED_TOKEN_START) == 0) {
+        return 0;
+    }
+    return reservedTokenTrie.longestMatch(text.substr(position), value);
+}
+
+void SubwordTextEncoder::encodeBytes(std::string_view subword, std::vector<int>& ids) const {
+    if (subword == "_") {
+        ids.push_back((int) subwords.size() + ' ' + 1);
+        return;
+    }
+
+    for (unsigned char byte : subword) {
+        ids.push_back((int) subwords.size() + byte + 1);
+    }
+}
+
+void SubwordTextEncoder::appendEscaped(std::string& result, std::string_view token) {
+    for (size_t position = 0;;) {
+        size_t underscore = token.find('_', position);
+        if (underscore == std::string_view::npos) {
+            result += token.substr(position);
+            return;
+        }
+
+        result += token.substr(position, underscore - position);
+        result += UNDERSCORE_REPLACEMENT;
+        position = underscore + 1;
+    }
+}
+
+size_t SubwordTextEncoder::characterLength(std::string_view text, size_t position) {
+    size_t end = position;
+    decodeCharacter(text, end);
+    return end - position;
+}
@@ -0,0 +1,16 @@
+#include "text_encoder.hpp"
+
+#include <stdio.h>
+
+#include "subalphabet_subword_text_encoder.hpp"
+#include "subword_text_encoder.hpp"
+
+std::unique_ptr<TextEncoder> loadTextEncoder(const std::string& filenamePrefix) {
+    FILE* subalphabet = fopen((filenamePrefix + ".subalphabet").c_str(), "rb");
+    if (subalphabet == nullptr) {
+        return std::unique_ptr<TextEncoder>(new SubwordTextEncoder(SubwordTextEncoder::loadFromFile(filenamePrefix)));
+    }
+
+    fclose(subalphabet);
+    return std::unique_ptr<TextEncoder>(new SubalphabetSubwordTextEncoder(SubalphabetSubwordTextEncoder::loadFromFile(filenamePrefix)));
+}
@@ -0,0 +1,36 @@
+#include "tokenizer.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "text_encoder.hpp"
+
+struct Tokenizer {
+    std::unique_ptr<TextEncoder> encoder;
+};
+
+Tokenizer* create_tokenizer(const char* filename_prefix) {
+    try {
+        return new Tokenizer{loadTextEncoder(filename_prefix)};
+    }
+    catch (const std::exception&) {
+        return nullptr;
+    }
+}
+
+void destroy_tokenizer(Tokenizer* tokenizer) {
+    delete tokenizer;
+}
+
+int get_vocab_size(const Tokenizer* tokenizer) {
+    return (int) tokenizer->encoder->vocabSize();
+}
+
+size_t encode_text(const Tokenizer* tokenizer, const char* text, size_t length, int* ids, size_t capacity) {
+    std::vector<int> result;
+    tokenizer->encoder->encode(std::string_view(text, length), result);
+
+    std::copy_n(result.begin(), std::min(result.size(), capacity), ids);
+    return result.size();
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+char32_t decodeMultibyteCharacter(std::string_view text, size_t& position);
+bool isNonAsciiWordCharacter(char32_t character);
+
+// Decodes the UTF-8 character at the position and moves past it. A byte that does not start a valid sequence is taken
+// as a character on its own, so that any input can be tokenized.
+inline char32_t decodeCharacter(std::string_view text, size_t& position) {
+    unsigned char lead = text[position];
+    if (lead < 0x80) {
+        position++;
+        return lead;
+    }
+    return decodeMultibyteCharacter(text, position);
+}
+
+// The characters that Python's re matches with \w: the ones for which str.isalnum() is true, and the underscore
+inline bool isWordCharacter(char32_t character) {
+    if (character < 0x80) {
+        return (character >= '0' && character <= '9') || (character >= 'A' && character <= 'Z') ||
+            (character >= 'a' && character <= 'z') || character == '_';
+    }
+    return isNonAsciiWordCharacter(character);
+}
+
+void appendCharacter(std::string& result, char32_t character);
+
+// Appends the text as Python's str.lower() returns it
+void appendLowercase(std::string& result, std::string_view text);
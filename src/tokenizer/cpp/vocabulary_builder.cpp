@@ -0,0 +1,339 @@
+#include "vocabulary_builder.hpp"
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#include "subword_text_encoder.hpp"
+#include "unicode.hpp"
+
+namespace {
+    // The defaults of build_from_corpus and _build_from_token_counts
+    const size_t MAX_SUBWORD_LENGTH = 20;
+    const int ITERATION_COUNT = 4;
+
+    const size_t SHARD_COUNT = 64;
+    const size_t TEXT_CHUNK_SIZE = 16;
+    const size_t TOKEN_CHUNK_SIZE = 1024;
+
+    template <typename Key>
+    using Counts = std::unordered_map<Key, int64_t>;
+
+    // The counts of one thread, split by hash into shards. A key is always in the same shard, so the shards of all
+    // threads can be added up on all threads at once.
+    template <typename Key>
+    class ShardedCounts {
+    public:
+        ShardedCounts(): shards(SHARD_COUNT) {
+        }
+
+        void add(const Key& key, int64_t count) {
+            shards[std::hash<Key>()(key) % SHARD_COUNT][key] += count;
+        }
+
+        std::vector<Counts<Key>> shards;
+    };
+
+    // Adds up the shards of all threads into the shards of the first one. The other shards are freed as they are added.
+    template <typename Key>
+    std::vector<Counts<Key>> mergeCounts(std::vector<ShardedCounts<Key>>& threadCounts) {
+        std::vector<Counts<Key>> result(SHARD_COUNT);
+
+        parallelFor((unsigned) threadCounts.size(), SHARD_COUNT, 1, [&threadCounts, &result](unsigned, size_t begin, size_t end) {
+            for (size_t shard = begin; shard < end; shard++) {
+                result[shard].swap(threadCounts[0].shards[shard]);
+                for (size_t thread = 1; thread < threadCounts.size(); thread++) {
+                    for (const auto& count : threadCounts[thread].shards[shard]) {
+                        result[shard][count.first] += count.second;
+                    }
+                    Counts<Key>().swap(threadCounts[thread].shards[shard]);
+                }
+            }
+        });
+        return result;
+    }
+
+    size_t characterCount(std::string_view text) {
+        size_t result = 0;
+        for (size_t position = 0; position < text.size(); result++) {
+            decodeCharacter(text, position);
+        }
+        return result;
+    }
+
+    size_t vocabSize(const std::vector<std::string>& subwords) {
+        return 1 + subwords.size() + 256;
+    }
+
+    size_t distance(size_t vocabSize, size_t targetVocabSize) {
+        return vocabSize > targetVocabSize ? vocabSize - targetVocabSize : targetVocabSize - vocabSize;
+    }
+
+    class VocabularyBuilder {
+    public:
+        VocabularyBuilder(const TextCorpus& corpus, unsigned threadCount);
+
+        std::vector<std::string> build(size_t targetVocabSize);
+
+    private:
+        using Candidates = std::vector<std::pair<std::string_view, int64_t>>;
+
+        // A substring of a token that is extended by a character at a time
+        struct Substring {
+            uint32_t token;
+            uint32_t start;
+            uint32_t end;
+        };
+
+        unsigned threadCount;
+        std::vector<std::pair<std::string, int64_t>> tokenCounts; // The candidates point into these strings
+
+        void countTokens(const TextCorpus& corpus);
+        std::vector<Substring> findSubwordStarts(const std::vector<std::string>& subwords) const;
+        Candidates countCandidates(const std::vector<std::string>& subwords, int64_t minTokenCount) const;
+        std::vector<std::string> buildSubwords(int64_t minTokenCount) const;
+        std::vector<std::string> search(int64_t minTokenCount, int64_t maxTokenCount, size_t targetVocabSize) const;
+
+        static std::vector<std::string> selectSubwords(const Candidates& candidates, int64_t minTokenCount);
+    };
+
+    VocabularyBuilder::VocabularyBuilder(const TextCorpus& corpus, unsigned threadCount): threadCount(threadCount) {
+        countTokens(corpus);
+    }
+
+    // Follows the binary search of build_from_corpus over the range of the token counts
+    std::vector<std::string> VocabularyBuilder::build(size_t targetVocabSize) {
+        if (tokenCounts.empty()) {
+            throw std::runtime_error("The corpus has no tokens");
+        }
+
+        int64_t minTokenCount = tokenCounts[0].second;
+        int64_t maxTokenCount = tokenCounts[0].second;
+        for (const auto& tokenCount : tokenCounts) {
+            minTokenCount = std::min(minTokenCount, tokenCount.second);
+            maxTokenCount = std::max(maxTokenCount, tokenCount.second);
+        }
+        return search(std::max<int64_t>(minTokenCount, 1), maxTokenCount, targetVocabSize);
+    }
+
+    // Follows _token_counts_from_generator, which only reserves the underscore replacement
+    void VocabularyBuilder::countTokens(const TextCorpus& corpus) {
+        SubwordTextEncoder tokenizer((std::vector<std::string>()));
+        std::vector<ShardedCounts<std::string>> threadCounts(threadCount);
+        std::vector<std::string> texts(threadCount);
+
+        parallelFor(threadCount, corpus.size(), TEXT_CHUNK_SIZE, [&](unsigned thread, size_t begin, size_t end) {
+            std::string& text = texts[thread];
+            ShardedCounts<std::string>& counts = threadCounts[thread];
+
+            for (size_t i = begin; i < end; i++) {
+                corpus.getText(i, text);
+                tokenizer.forEachToken(text, [&counts](std::string_view token) {
+                    counts.add(std::string(token), 1);
+                });
+            }
+        });
+
+        for (Counts<std::string>& shard : mergeCounts(threadCounts)) {
+            tokenCounts.insert(tokenCounts.end(), shard.begin(), shard.end());
+        }
+    }
+
+    // The substrings start where the subwords of the tokens do, as in _build_from_token_counts
+    std::vector<VocabularyBuilder::Substring> VocabularyBuilder::findSubwordStarts(const std::vector<std::string>& subwords) const {
+        SubwordTextEncoder encoder(subwords);
+        std::vector<std::vector<Substring>> threadStarts(threadCount);
+
+        parallelFor(threadCount, tokenCounts.size(), TOKEN_CHUNK_SIZE, [&](unsigned thread, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                std::string_view token = tokenCounts[i].first;
+                encoder.forEachSubword(token, [&](std::string_view subword, int) {
+                    uint32_t start = (uint32_t) (subword.data() - token.data());
+                    threadStarts[thread].push_back(Substring{(uint32_t) i, start, start});
+                });
+            }
+        });
+
+        std::vector<Substring> result;
+        for (std::vector<Substring>& starts : threadStarts) {
+            result.insert(result.end(), starts.begin(), starts.end());
+            std::vector<Substring>().swap(starts);
+        }
+        return result;
+    }
+
+    // Returns the substrings of up to MAX_SUBWORD_LENGTH characters at the subword starts that are counted at least
+    // minTokenCount times and are longer than a byte. Python counts all of them, but a substring is never counted more
+    // often than its prefixes, so here they are counted one character longer at a time, and only the substrings whose
+    // prefix has been counted often enough are extended.
+    VocabularyBuilder::Candidates VocabularyBuilder::countCandidates(const std::vector<std::string>& subwords, int64_t minTokenCount) const {
+        std::vector<Substring> substrings = findSubwordStarts(subwords);
+        Candidates result;
+
+        for (size_t length = 1; length <= MAX_SUBWORD_LENGTH && !substrings.empty(); length++) {
+            std::vector<ShardedCounts<std::string_view>> threadCounts(threadCount);
+
+            parallelFor(threadCount, substrings.size(), TOKEN_CHUNK_SIZE, [&](unsigned thread, size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    Substring& substring = substrings[i];
+                    const auto& tokenCount = tokenCounts[substring.token];
+                    std::string_view token = tokenCount.first;
+
+                    // A substring at the end of its token is done; it is marked by making it empty
+                    if (substring.end == token.size()) {
+                        substring.start = substring.end;
+                        continue;
+                    }
+
+                    size_t substringEnd = substring.end;
+                    decodeCharacter(token, substringEnd);
+                    substring.end = (uint32_t) substringEnd;
+                    threadCounts[thread].add(token.substr(substring.start, substring.end - substring.start), tokenCount.second);
+                }
+            });
+
+            // Only the substrings that are counted often enough are kept, both as candidates and to be extended
+            std::vector<Counts<std::string_view>> shards = mergeCounts(threadCounts);
+            std::vector<Candidates> shardCandidates(SHARD_COUNT);
+            parallelFor(threadCount, SHARD_COUNT, 1, [&](unsigned, size_t begin, size_t end) {
+                for (size_t shard = begin; shard < end; shard++) {
+                    for (auto count = shards[shard].begin(); count != shards[shard].end();) {
+                        if (count->second < minTokenCount) {
+                            count = shards[shard].erase(count);
+                            continue;
+                        }
+
+                        if (count->first.size() > 1) {
+                            shardCandidates[shard].push_back(*count);
+                        }
+                        ++count;
+                    }
+                }
+            });
+            for (const Candidates& candidates : shardCandidates) {
+                result.insert(result.end(), candidates.begin(), candidates.end());
+            }
+
+            std::vector<std::vector<Substring>> threadSubstrings(threadCount);
+            parallelFor(threadCount, substrings.size(), TOKEN_CHUNK_SIZE, [&](unsigned thread, size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    const Substring& substring = substrings[i];
+                    if (substring.start == substring.end) {
+                        continue;
+                    }
+
+                    std::string_view text = std::string_view(tokenCounts[substring.token].first).substr(substring.start, substring.end - substring.start);
+                    if (shards[std::hash<std::string_view>()(text) % SHARD_COUNT].count(text) > 0) {
+                        threadSubstrings[thread].push_back(substring);
+                    }
+                }
+            });
+
+            substrings.clear();
+            for (const std::vector<Substring>& extendedSubstrings : threadSubstrings) {
+                substrings.insert(substrings.end(), extendedSubstrings.begin(), extendedSubstrings.end());
+            }
+        }
+        return result;
+    }
+
+    // Follows _build_from_token_counts without reserved tokens
+    std::vector<std::string> VocabularyBuilder::buildSubwords(int64_t minTokenCount) const {
+        std::vector<std::string> subwords;
+        for (int iteration = 0; iteration < ITERATION_COUNT; iteration++) {
+            subwords = selectSubwords(countCandidates(subwords, minTokenCount), minTokenCount);
+        }
+        return subwords;
+    }
+
+    std::vector<std::string> VocabularyBuilder::search(int64_t minTokenCount, int64_t maxTokenCount, size_t targetVocabSize) const {
+        int64_t candidateMin = (minTokenCount + maxTokenCount) / 2;
+        std::vector<std::string> subwords = buildSubwords(candidateMin);
+
+        // Being within 1% of the target vocab size is ok
+        size_t subwordsDistance = distance(vocabSize(subwords), targetVocabSize);
+        if (subwordsDistance * 100 < targetVocabSize || minTokenCount >= maxTokenCount || candidateMin <= 1) {
+            return subwords;
+        }
+
+        std::vector<std::string> next = vocabSize(subwords) > targetVocabSize ?
+            search(candidateMin + 1, maxTokenCount, targetVocabSize) :
+            search(minTokenCount, candidateMin - 1, targetVocabSize);
+        return subwordsDistance < distance(vocabSize(next), targetVocabSize) ? subwords : next;
+    }
+
+    // The candidates are taken longest first, and each one takes its count away from its prefixes. The order of the
+    // candidates of the same length does not matter, since none of them is a prefix of another.
+    std::vector<std::string> VocabularyBuilder::selectSubwords(const Candidates& candidates, int64_t minTokenCount) {
+        Counts<std::string_view> counts;
+        std::vector<std::vector<std::string_view>> candidatesByLength(MAX_SUBWORD_LENGTH + 1);
+        for (const auto& candidate : candidates) {
+            if (candidate.second >= minTokenCount) {
+                counts.insert(candidate);
+                candidatesByLength[characterCount(candidate.first)].push_back(candidate.first);
+            }
+        }
+
+        std::vector<std::pair<int64_t, std::string_view>> selected;
+        for (size_t length = MAX_SUBWORD_LENGTH; length > 0; length--) {
+            for (std::string_view candidate : candidatesByLength[length]) {
+                int64_t count = counts[candidate];
+                if (count < minTokenCount) {
+                    continue;
+                }
+                selected.emplace_back(count, candidate);
+
+                size_t prefixEnd = 0;
+                decodeCharacter(candidate, prefixEnd);
+                while (prefixEnd < candidate.size()) {
+                    auto prefix = counts.find(candidate.substr(0, prefixEnd));
+                    if (prefix != counts.end()) {
+                        prefix->second -= count;
+                    }
+                    decodeCharacter(candidate, prefixEnd);
+                }
+            }
+        }
+
+        // Python sorts the (count, subword) pairs in reverse, so equal counts are in reverse code point order
+        std::sort(selected.begin(), selected.end(), [](const auto& left, const auto& right) {
+            return left > right;
+        });
+
+        std::vector<std::string> result;
+        result.reserve(selected.size());
+        for (const auto& subword : selected) {
+            result.emplace_back(subword.second);
+        }
+        return result;
+    }
+}
+
+void parallelFor(unsigned threadCount, size_t count, size_t chunkSize, const std::function<void(unsigned, size_t, size_t)>& work) {
+    std::atomic<size_t> nextChunk(0);
+    auto takeChunks = [count, chunkSize, &work, &nextChunk](unsigned thread) {
+        for (size_t begin; (begin = nextChunk.fetch_add(chunkSize)) < count;) {
+            work(thread, begin, std::min(begin + chunkSize, count));
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned thread = 1; thread < threadCount; thread++) {
+        threads.emplace_back(takeChunks, thread);
+    }
+    takeChunks(0);
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+std::vector<std::string> buildSubwords(const TextCorpus& corpus, size_t targetVocabSize, unsigned threadCount) {
+    VocabularyBuilder builder(corpus, std::max(threadCount, 1u));
+    return builder.build(targetVocabSize);
+}
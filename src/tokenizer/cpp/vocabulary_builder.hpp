@@ -0,0 +1,15 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "text_corpus.hpp"
+
+// Calls work(thread, begin, end) for the ranges of indices from 0 to count, which the threads take chunk by chunk in
+// increasing order. The calling thread is one of them.
+void parallelFor(unsigned threadCount, size_t count, size_t chunkSize, const std::function<void(unsigned, size_t, size_t)>& work);
+
+// Picks the subwords as SubwordTextEncoder.build_from_corpus does with its default arguments: a binary search for the
+// minimum subword count whose vocabulary comes closest to the target size
+std::vector<std::string> buildSubwords(const TextCorpus& corpus, size_t targetVocabSize, unsigned threadCount);
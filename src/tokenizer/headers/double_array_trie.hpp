@@ -0,0 +1,170 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// A byte-wise trie packed into one array: the child of a node for a byte is at base + byte, and belongs to the node only
+// if its check is the node's index. Following a key costs one random access per byte, with no hashing and no copies of
+// the text, which makes the longest match at every position of the text cheap.
+class DoubleArrayTrie {
+public:
+    static const int NO_VALUE = -1;
+
+    DoubleArrayTrie(): firstFree(NO_NODE), lastFree(NO_NODE) {
+        nodes.push_back(Node{0, ROOT_CHECK, NO_VALUE});
+    }
+
+    // The keys have to be sorted and unique, and the values not negative
+    DoubleArrayTrie(const std::vector<std::pair<std::string, int>>& entries): DoubleArrayTrie() {
+        insertChildren(0, entries, 0, entries.size(), 0);
+
+        while (!nodes.empty() && nodes.back().check == FREE) {
+            nodes.pop_back();
+        }
+    }
+
+    // Returns the length of the longest key that the text starts with, or 0 if there is none, and sets its value
+    size_t longestMatch(std::string_view text, int& value) const {
+        size_t result = 0;
+        int node = 0;
+
+        for (size_t i = 0; i < text.size(); i++) {
+            size_t child = (size_t) nodes[node].base + (unsigned char) text[i];
+            if (child >= nodes.size() || nodes[child].check != node) {
+                break;
+            }
+
+            node = (int) child;
+            if (nodes[node].value != NO_VALUE) {
+                result = i + 1;
+                value = nodes[node].value;
+            }
+        }
+        return result;
+    }
+
+    // Whether any key starts with the byte; most positions of a text fail here
+    bool hasKeyStartingWith(unsigned char byte) const {
+        size_t child = (size_t) nodes[0].base + byte;
+        return child < nodes.size() && nodes[child].check == 0;
+    }
+
+private:
+    static const int FREE = -1;
+    static const int ROOT_CHECK = -2;
+    static const int NO_NODE = -1;
+
+    // A free node is linked to the next and the previous free ones through its base and value, in increasing order,
+    // so that finding room for the children of a node only looks at the free nodes
+    struct Node {
+        int base;
+        int check; // The index of the parent
+        int value;
+    };
+
+    std::vector<Node> nodes;
+    int firstFree;
+    int lastFree;
+
+    // The entries in [begin, end) share their first depth bytes, which lead to the node
+    void insertChildren(int node, const std::vector<std::pair<std::string, int>>& entries, size_t begin, size_t end, size_t depth) {
+        if (begin < end && entries[begin].first.size() == depth) {
+            nodes[node].value = entries[begin].second;
+            begin++;
+        }
+        if (begin == end) {
+            return;
+        }
+
+        std::vector<unsigned char> labels;
+        for (size_t i = begin; i < end; i++) {
+            unsigned char label = entries[i].first[depth];
+            if (labels.empty() || labels.back() != label) {
+                labels.push_back(label);
+            }
+        }
+
+        int base = findBase(labels);
+        nodes[node].base = base;
+        for (unsigned char label : labels) {
+            unlinkFree(base + label);
+            nodes[base + label] = Node{0, node, NO_VALUE};
+        }
+
+        size_t childBegin = begin;
+        for (unsigned char label : labels) {
+            size_t childEnd = childBegin;
+            while (childEnd < end && (unsigned char) entries[childEnd].first[depth] == label) {
+                childEnd++;
+            }
+            insertChildren(base + label, entries, childBegin, childEnd, depth + 1);
+            childBegin = childEnd;
+        }
+    }
+
+    // The first base at which all the children fit into free nodes
+    int findBase(const std::vector<unsigned char>& labels) {
+        for (int position = firstFree;; position = nodes[position].base) {
+            if (position == NO_NODE) {
+                position = (int) nodes.size();
+                appendFree(nodes.size() + 256);
+            }
+            if (position <= labels[0]) {
+                continue;
+            }
+
+            size_t base = position - labels[0];
+            if (nodes.size() < base + 256) {
+                appendFree(base + 256);
+            }
+
+            bool fits = true;
+            for (unsigned char label : labels) {
+                if (nodes[base + label].check != FREE) {
+                    fits = false;
+                    break;
+                }
+            }
+            if (fits) {
+                return (int) base;
+            }
+        }
+    }
+
+    void appendFree(size_t size) {
+        int first = (int) nodes.size();
+        nodes.resize(size, Node{NO_NODE, FREE, NO_NODE});
+        for (int i = first; i < (int) size; i++) {
+            nodes[i].base = i + 1 < (int) size ? i + 1 : NO_NODE;
+            nodes[i].value = i > first ? i - 1 : lastFree;
+        }
+
+        if (lastFree == NO_NODE) {
+            firstFree = first;
+        }
+        else {
+            nodes[lastFree].base = first;
+        }
+        lastFree = (int) size - 1;
+    }
+
+    void unlinkFree(int node) {
+        int next = nodes[node].base;
+        int previous = nodes[node].value;
+
+        if (previous == NO_NODE) {
+            firstFree = next;
+        }
+        else {
+            nodes[previous].base = next;
+        }
+        if (next == NO_NODE) {
+            lastFree = previous;
+        }
+        else {
+            nodes[next].value = previous;
+        }
+    }
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "subword_text_encoder.hpp"
+#include "text_corpus.hpp"
+#include "text_encoder.hpp"
+
+// Encodes text into the same ids as the notebooks' SubalphabetSubwordTextEncoder. The text is lowercased, its HTML
+// entities are replaced, and every run of characters outside of the subalphabet becomes a single 'X'. It is then encoded
+// with the subwords, and the 256 byte ids are replaced by one id for every character of the subalphabet.
+class SubalphabetSubwordTextEncoder : public TextEncoder {
+public:
+    static const char32_t SPECIAL_CHARACTER = 'X';
+
+    // The subalphabet starts with '\0' and the special character, as in Python
+    SubalphabetSubwordTextEncoder(std::vector<char32_t> subalphabet, SubwordTextEncoder subwordTextEncoder);
+
+    // Loads <filenamePrefix>.subwords and the NUL-separated characters in <filenamePrefix>.subalphabet
+    static SubalphabetSubwordTextEncoder loadFromFile(const std::string& filenamePrefix);
+
+    // Follows build_from_corpus: the subalphabet is made of the most common characters of the lowercased and unescaped
+    // texts, and the subwords are built from the texts as they are preprocessed with it
+    static SubalphabetSubwordTextEncoder buildFromCorpus(const TextCorpus& corpus, size_t subalphabetSize, size_t targetVocabSize, unsigned threadCount);
+
+    // Writes <filenamePrefix>.subwords and <filenamePrefix>.subalphabet in the same format as save_to_file
+    void saveToFile(const std::string& filenamePrefix) const;
+
+    void encode(std::string_view text, std::vector<int>& ids) const override;
+
+    size_t vocabSize() const override {
+        return subwordTextEncoder.vocabSize() - 256 + subalphabet.size();
+    }
+
+    // The text that the subwords encode, as preprocess_string returns it
+    std::string preprocess(std::string_view text) const;
+
+private:
+    SubwordTextEncoder subwordTextEncoder;
+    std::vector<char32_t> subalphabet;
+    std::unordered_map<char32_t, int> codes; // The index of every character in the subalphabet
+    std::vector<int> asciiCodes; // The same for the ASCII characters, -1 if not in the subalphabet
+
+    int findCode(char32_t character) const;
+    void compact(std::string& result, std::string_view text) const;
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "double_array_trie.hpp"
+#include "text_corpus.hpp"
+#include "text_encoder.hpp"
+
+// Encodes text into the same ids as tfds.features.text.SubwordTextEncoder. The subwords follow the padding in the order
+// of the vocabulary and the last 256 ids are the bytes that no subword matches.
+class SubwordTextEncoder : public TextEncoder {
+public:
+    // Python escapes the underscores in the text with this, because in the subwords "_" stands for a following space
+    static constexpr std::string_view UNDERSCORE_REPLACEMENT = "\\&undr;";
+
+    SubwordTextEncoder(std::vector<std::string> subwords);
+
+    // Loads the <filenamePrefix>.subwords file that SubwordTextEncoder.save_to_file writes
+    static SubwordTextEncoder loadFromFile(const std::string& filenamePrefix);
+
+    // Follows SubwordTextEncoder.build_from_corpus, with the counting spread over the threads
+    static SubwordTextEncoder buildFromCorpus(const TextCorpus& corpus, size_t targetVocabSize, unsigned threadCount);
+
+    // Writes <filenamePrefix>.subwords in the same format as SubwordTextEncoder.save_to_file
+    void saveToFile(const std::string& filenamePrefix) const;
+
+    void encode(std::string_view text, std::vector<int>& ids) const override;
+
+    // Calls handler(token) for every token of the text, as _prepare_tokens_for_encode returns them
+    template <typename Handler>
+    void forEachToken(std::string_view text, Handler handler) const;
+
+    // Calls handler(subword, id) for every subword of a token in the order of _token_to_subwords. A character that no
+    // subword matches comes on its own with an id of -1.
+    template <typename Handler>
+    void forEachSubword(std::string_view token, Handler handler) const;
+
+    size_t vocabSize() const override {
+        return 1 + subwords.size() + 256;
+    }
+
+    size_t subwordCount() const {
+        return subwords.size();
+    }
+
+private:
+    std::vector<std::string> subwords;
+    DoubleArrayTrie subwordTrie;
+
+    // The subwords that mix word and non-word characters; they are split out of the text before anything else
+    DoubleArrayTrie reservedTokenTrie;
+
+    enum ByteClass : unsigned char {
+        OTHER_BYTE = 0,
+        WORD_BYTE = 1,
+        NON_ASCII_BYTE = 2,
+        RESERVED_TOKEN_START = 4, // Combined with one of the above
+    };
+    unsigned char byteClasses[256];
+
+    size_t findTokenEnd(std::string_view text, size_t position) const;
+    size_t findReservedToken(std::string_view text, size_t position) const;
+    void encodeBytes(std::string_view subword, std::vector<int>& ids) const;
+
+    static void appendEscaped(std::string& result, std::string_view token);
+    static size_t characterLength(std::string_view text, size_t position);
+};
+
+// The tokens are split off one at a time, with the next one looked at in advance, and get a "_" instead of a single space
+// that follows them. Python encodes the replacement as two tokens and, unlike anywhere else, keeps the space after it.
+template <typename Handler>
+void SubwordTextEncoder::forEachToken(std::string_view text, Handler handler) const {
+    std::string preparedToken;
+    size_t tokenStart = 0;
+    size_t tokenEnd = findTokenEnd(text, tokenStart);
+
+    while (tokenStart < text.size()) {
+        std::string_view token = text.substr(tokenStart, tokenEnd - tokenStart);
+        size_t nextStart = tokenEnd;
+        size_t nextEnd = findTokenEnd(text, nextStart);
+        bool followedBySpace = nextEnd == nextStart + 1 && text[nextStart] == ' ';
+
+        if (token == UNDERSCORE_REPLACEMENT) {
+            handler(UNDERSCORE_REPLACEMENT.substr(0, 2));
+            preparedToken = UNDERSCORE_REPLACEMENT.substr(2);
+            if (followedBySpace) {
+                preparedToken += '_';
+            }
+            handler(std::string_view(preparedToken));
+        }
+        else if (followedBySpace || token.find('_') != std::string_view::npos) {
+            preparedToken.clear();
+            appendEscaped(preparedToken, token);
+            if (followedBySpace) {
+                preparedToken += '_';
+                nextStart = nextEnd;
+                nextEnd = findTokenEnd(text, nextStart);
+            }
+            handler(std::string_view(preparedToken));
+        }
+        else {
+            handler(token);
+        }
+
+        tokenStart = nextStart;
+        tokenEnd = nextEnd;
+    }
+}
+
+// Python tries at most as many characters as the longest subword has, longest first, so the longest prefix that is in
+// the trie is the same subword
+template <typename Handler>
+void SubwordTextEncoder::forEachSubword(std::string_view token, Handler handler) const {
+    for (size_t start = 0; start < token.size();) {
+        int subwordId;
+        size_t length = subwordTrie.longestMatch(token.substr(start), subwordId);
+        if (length == 0) {
+            length = characterLength(token, start);
+            subwordId = -1;
+        }
+
+        handler(token.substr(start, length), subwordId);
+        start += length;
+    }
+}
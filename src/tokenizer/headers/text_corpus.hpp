@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+
+// The texts that a vocabulary is built from. They are produced on demand, so that a large corpus can stay in a mapped
+// file, and are asked for from several threads at once.
+class TextCorpus {
+public:
+    virtual ~TextCorpus() {
+    }
+
+    virtual size_t size() const = 0;
+
+    // Replaces the text with the one at the index
+    virtual void getText(size_t index, std::string& text) const = 0;
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The interface of the encoders, as in tfds.features.text.TextEncoder. The id 0 is always left for padding.
+class TextEncoder {
+public:
+    virtual ~TextEncoder() {
+    }
+
+    // Appends the ids of the UTF-8 text; it is safe to call from several threads at once
+    virtual void encode(std::string_view text, std::vector<int>& ids) const = 0;
+
+    virtual size_t vocabSize() const = 0;
+};
+
+// Loads <filenamePrefix>.subwords, as a SubalphabetSubwordTextEncoder if there is a <filenamePrefix>.subalphabet too
+std::unique_ptr<TextEncoder> loadTextEncoder(const std::string& filenamePrefix);
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stddef.h>
+
+#ifdef _WIN32
+#define TOKENIZER_API __declspec(dllexport)
+#else
+#define TOKENIZER_API __attribute__((visibility("default")))
+#endif
+
+// A C interface for loading the tokenizer from Python with ctypes, in the same way as the Huffman DLLs:
+//
+//     tokenizer = ctypes.CDLL('tokenizer')
+//     tokenizer.create_tokenizer.restype = ctypes.c_void_p
+//     tokenizer.encode_text.restype = ctypes.c_size_t
+//     tokenizer.encode_text.argtypes = [
+//         ctypes.c_void_p, ctypes.c_char_p, ctypes.c_size_t, ctypes.POINTER(ctypes.c_int), ctypes.c_size_t]
+//     encoder = ctypes.c_void_p(tokenizer.create_tokenizer(b'72_1024'))
+//     data = text.encode('utf-8')
+//     ids = np.zeros(2 * len(data), dtype=np.int32)
+//     count = tokenizer.encode_text(encoder, data, len(data), ids.ctypes.data_as(ctypes.POINTER(ctypes.c_int)), len(ids))
+//
+// The text goes in as UTF-8 bytes and its length in bytes: ctypes would pass a str as wchar_t*, and len(text) counts
+// characters. When count is larger than the buffer, the text has to be encoded again with a buffer of count ids.
+typedef struct Tokenizer Tokenizer;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Loads <filename_prefix>.subwords, and <filename_prefix>.subalphabet if there is one; returns NULL on failure
+TOKENIZER_API Tokenizer* create_tokenizer(const char* filename_prefix);
+
+TOKENIZER_API void destroy_tokenizer(Tokenizer* tokenizer);
+
+TOKENIZER_API int get_vocab_size(const Tokenizer* tokenizer);
+
+// Encodes the UTF-8 text and returns the number of its ids, of which at most capacity are written
+TOKENIZER_API size_t encode_text(const Tokenizer* tokenizer, const char* text, size_t length, int* ids, size_t capacity);
+
+#ifdef __cplusplus
+}
+#endif